@@ -0,0 +1,392 @@
+/*
+ * fleet_sim.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Host fleet simulation runner
+ *
+ * Replays recorded runs against candidate routes and distance thresholds using
+ * the device navigation code (nav_update()) and reports, per run, when turn cues
+ * were given relative to reaching the waypoint and how many waypoints were
+ * missed. Every (route, thresholds, run) combination is an independent job on a
+ * work-stealing thread pool.
+ *
+ * Usage:
+ * 		fleet_sim [-j threads] [-t tick_ms] [-c change,...] [-n notify,...]
+ * 			[-L lead_ms,...] [-r reasonable,...] -R route [-R route ...]
+ * 			[-l run_list] run ...
+ *
+ * Threshold options take comma separated lists and every combination is run.
+ * With -t the scheduler ticks (nav_tick()) between fixes are simulated too.
+ * A run list file holds one recorded run path per line. Results are written to
+ * stdout as CSV, one line per job.
+ *
+ * Build:
+ * 		cc -O2 -pthread -I"../_Initial Code" -o fleet_sim fleet_sim.c work_pool.c
+ * 			route_file.c run_file.c sim_hw.c "../_Initial Code/navigation.c"
+ * 			"../_Initial Code/kalman.c" "../_Initial Code/run_stats.c"
+ * 			"../_Initial Code/heading.c" "../_Initial Code/ghost.c"
+ * 			"../_Initial Code/waypt_log.c" "../_Initial Code/route_table.c"
+ * 			"../_Initial Code/route_lib.c" "../_Initial Code/sd.c"
+ * 			"../_Initial Code/crc.c" "../_Initial Code/auto_pause.c" -lm
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "navigation.h"
+#include "route_file.h"
+#include "run_file.h"
+#include "work_pool.h"
+
+#define MAX_ROUTES 256
+#define MAX_THRESHOLDS 16
+
+// Result of replaying one run against one route and configuration
+typedef struct {
+	uint32_t fixes;			// fixes in the run
+	uint16_t reached;		// waypoints reached
+	uint16_t missed;		// waypoints never reached
+	uint16_t cues;			// turn cues given
+	uint16_t late_cues;		// cues given at or after the turn
+	uint16_t scored;		// reached waypoints that had a cue
+	int64_t lead_sum;		// ms between cue and turn, summed
+	int32_t lead_min;
+	int32_t lead_max;
+	uint32_t distance;		// meters run
+	uint8_t complete;
+	uint8_t loaded;			// the run file could be read
+} sim_result;
+
+// Everything the jobs share (read-only while they run)
+typedef struct {
+	route_file* routes;
+	uint32_t num_routes;
+	nav_config* configs;
+	uint32_t num_configs;
+	run_file* runs;
+	char** run_paths;
+	uint32_t num_runs;
+	sim_result* results;
+	uint16_t tick_ms;		// scheduler tick to simulate, 0 for fixes only
+} sim_jobs;
+
+/*
+ * Finds when the run passed closest to a waypoint, searching the fixes from the one
+ * where the waypoint became active up to (not including) the last one given
+ *
+ * return: run clock time in ms
+ */
+static uint32_t turn_time(const run_file* run, const waypoint* waypt, uint32_t from,
+		uint32_t to) {
+	uint32_t best = from;
+	uint16_t best_distance = UINT16_MAX;
+	uint32_t i;
+
+	for (i = from; i < to; i++) {
+		waypoint p;
+		uint16_t d;
+
+		if (!run->fixes[i].valid)
+			continue;
+
+		p.latitude = run->fixes[i].latitude;
+		p.longitude = run->fixes[i].longitude;
+		d = dist_between_waypts(&p, waypt);
+		if (d < best_distance) {
+			best_distance = d;
+			best = i;
+		}
+	}
+
+	return run->fixes[best].stamp;
+}
+
+/*
+ * Replays one run through a fresh navigation context. Cues are scored against the
+ * moment the runner actually passed the waypoint (closest approach), not against the
+ * moment the navigation switched to the next waypoint.
+ */
+static void simulate(const route_file* route, const nav_config* config,
+		const run_file* run, uint16_t tick_ms, sim_result* result) {
+	uint32_t cue_time[MAX_WAYPTS];
+	uint8_t cue_set[MAX_WAYPTS];
+	uint32_t active_from[MAX_WAYPTS + 2];	// fix index where each waypoint became active
+	nav_state nav;
+	uint32_t i;
+	uint16_t k;
+
+	memset(result, 0, sizeof(*result));
+	memset(cue_set, 0, sizeof(cue_set));
+	result->lead_min = INT32_MAX;
+	result->lead_max = INT32_MIN;
+	result->fixes = run->num_fixes;
+	result->loaded = 1;
+
+	nav.config = *config;
+	if (!init_nav(&nav, route->waypts, route->num_waypts))
+		return;
+
+	active_from[0] = 0;
+	for (i = 0; i < run->num_fixes && !nav.complete; i++) {
+		uint32_t now = run->fixes[i].stamp;
+		uint8_t waypt = nav.current_waypt_num;
+		uint32_t next, t;
+
+		// Fix, then the scheduler ticks up to the next fix. The fix is always fed, a
+		// next fix with the same stamp (a repeated UTC time) only leaves no ticks.
+		next = (tick_ms == 0 || i + 1 == run->num_fixes) ? now + 1 :
+			run->fixes[i + 1].stamp;
+
+		for (t = now; (t == now || t < next) && !nav.complete;
+				t += (tick_ms ? tick_ms : 1)) {
+			direction turn = (t == now) ? nav_update(&nav, &run->fixes[i]) :
+				nav_tick(&nav, t);
+
+			if (turn != NONE) {
+				result->cues++;
+				cue_time[nav.cue_waypt] = t;
+				cue_set[nav.cue_waypt] = 1;
+			}
+		}
+
+		// Waypoints reached on this fix
+		for (; waypt < nav.current_waypt_num; waypt++)
+			active_from[waypt + 1] = i;
+		if (nav.complete)
+			active_from[route->num_waypts] = i;
+	}
+
+	result->reached = nav.complete ? route->num_waypts : nav.current_waypt_num;
+	for (k = result->reached + 1; k < route->num_waypts + 2; k++)
+		active_from[k] = run->num_fixes;
+
+	// Score the cues of the waypoints that were reached (the start has no turn to time)
+	for (k = 1; k < result->reached; k++) {
+		int32_t lead;
+
+		if (!cue_set[k])
+			continue;
+
+		lead = (int32_t)(turn_time(run, &route->waypts[k], active_from[k],
+			active_from[k + 2]) - cue_time[k]);
+
+		result->scored++;
+		if (lead <= 0)
+			result->late_cues++;
+		result->lead_sum += lead;
+		if (lead < result->lead_min)
+			result->lead_min = lead;
+		if (lead > result->lead_max)
+			result->lead_max = lead;
+	}
+
+	result->missed = route->num_waypts - result->reached;
+	result->distance = nav.stats.distance / 100;
+	result->complete = nav.complete;
+}
+
+/*
+ * Pool job: load one recorded run
+ */
+static void load_job(uint32_t job, void* arg) {
+	sim_jobs* jobs = arg;
+
+	if (run_load(jobs->run_paths[job], &jobs->runs[job]) != 0) {
+		fprintf(stderr, "fleet_sim: can't read run %s\n", jobs->run_paths[job]);
+		jobs->runs[job].fixes = NULL;
+		jobs->runs[job].num_fixes = 0;
+	}
+}
+
+/*
+ * Pool job: replay one (route, configuration, run) combination. Jobs are ordered
+ * run-major so the threads share routes while each run stays in one cache.
+ */
+static void sim_job(uint32_t job, void* arg) {
+	sim_jobs* jobs = arg;
+	uint32_t run = job / (jobs->num_routes * jobs->num_configs);
+	uint32_t rest = job % (jobs->num_routes * jobs->num_configs);
+	uint32_t route = rest / jobs->num_configs;
+	uint32_t config = rest % jobs->num_configs;
+
+	if (jobs->runs[run].fixes == NULL)
+		return;
+
+	simulate(&jobs->routes[route], &jobs->configs[config], &jobs->runs[run],
+		jobs->tick_ms, &jobs->results[job]);
+}
+
+/*
+ * Parses a comma separated list of distances
+ *
+ * return: number of values read, 0 on a malformed list
+ */
+static uint32_t parse_list(const char* text, uint16_t* values) {
+	uint32_t count = 0;
+	char* end;
+
+	while (count < MAX_THRESHOLDS) {
+		long v = strtol(text, &end, 10);
+		if (end == text || v < 0 || v > 65535)
+			return 0;
+		values[count++] = (uint16_t)v;
+		if (*end != ',')
+			break;
+		text = end + 1;
+	}
+
+	return (*end == 0) ? count : 0;
+}
+
+/*
+ * Adds the paths listed in a run list file
+ */
+static int read_run_list(const char* path, char*** paths, uint32_t* count, uint32_t* cap) {
+	char line[1024];
+	FILE* f = fopen(path, "r");
+
+	if (f == NULL)
+		return -1;
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		line[strcspn(line, "\r\n")] = 0;
+		if (line[0] == 0)
+			continue;
+		if (*count == *cap) {
+			*cap *= 2;
+			*paths = realloc(*paths, *cap * sizeof(char*));
+		}
+		(*paths)[(*count)++] = strdup(line);
+	}
+
+	fclose(f);
+	return 0;
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: fleet_sim [-j threads] [-t tick_ms] [-c change,...] "
+		"[-n notify,...] [-L lead_ms,...] [-r reasonable,...] -R route [-R route ...] "
+		"[-l run_list] run ...\n");
+	exit(2);
+}
+
+int main(int argc, char** argv) {
+	uint16_t change[MAX_THRESHOLDS] = { CHANGE_DISTANCE };
+	uint16_t notify[MAX_THRESHOLDS] = { NOTIFY_DISTANCE };
+	uint16_t reasonable[MAX_THRESHOLDS] = { REASONABLE_DISTANCE };
+	uint16_t lead[MAX_THRESHOLDS] = { CUE_LEAD_TIME };
+	uint32_t num_change = 1, num_notify = 1, num_reasonable = 1, num_lead = 1;
+	uint32_t run_cap = 1024, num_jobs, i, a, b, c, d;
+	unsigned threads = 0;
+	sim_jobs jobs;
+	int opt;
+
+	memset(&jobs, 0, sizeof(jobs));
+	jobs.routes = calloc(MAX_ROUTES, sizeof(route_file));
+	jobs.run_paths = malloc(run_cap * sizeof(char*));
+
+	while ((opt = getopt(argc, argv, "j:t:c:n:L:r:R:l:")) != -1) {
+		switch (opt) {
+			case 'j':
+				threads = (unsigned)atoi(optarg);
+				break;
+			case 't':
+				jobs.tick_ms = (uint16_t)atoi(optarg);
+				break;
+			case 'c':
+				if ((num_change = parse_list(optarg, change)) == 0)
+					usage();
+				break;
+			case 'n':
+				if ((num_notify = parse_list(optarg, notify)) == 0)
+					usage();
+				break;
+			case 'L':
+				if ((num_lead = parse_list(optarg, lead)) == 0)
+					usage();
+				break;
+			case 'r':
+				if ((num_reasonable = parse_list(optarg, reasonable)) == 0)
+					usage();
+				break;
+			case 'R':
+				if (jobs.num_routes == MAX_ROUTES ||
+						route_load(optarg, &jobs.routes[jobs.num_routes]) != 0 ||
+						!array_valid(jobs.routes[jobs.num_routes].waypts,
+							jobs.routes[jobs.num_routes].num_waypts)) {
+					fprintf(stderr, "fleet_sim: bad route %s\n", optarg);
+					return 1;
+				}
+				jobs.num_routes++;
+				break;
+			case 'l':
+				if (read_run_list(optarg, &jobs.run_paths, &jobs.num_runs, &run_cap) != 0) {
+					fprintf(stderr, "fleet_sim: can't read run list %s\n", optarg);
+					return 1;
+				}
+				break;
+			default:
+				usage();
+		}
+	}
+
+	for (; optind < argc; optind++) {
+		if (jobs.num_runs == run_cap) {
+			run_cap *= 2;
+			jobs.run_paths = realloc(jobs.run_paths, run_cap * sizeof(char*));
+		}
+		jobs.run_paths[jobs.num_runs++] = strdup(argv[optind]);
+	}
+
+	if (jobs.num_routes == 0 || jobs.num_runs == 0)
+		usage();
+
+	// Every combination of thresholds
+	jobs.num_configs = num_change * num_notify * num_reasonable * num_lead;
+	jobs.configs = malloc(jobs.num_configs * sizeof(nav_config));
+	for (a = 0, i = 0; a < num_change; a++)
+		for (b = 0; b < num_notify; b++)
+			for (c = 0; c < num_reasonable; c++)
+				for (d = 0; d < num_lead; d++, i++) {
+					jobs.configs[i].change_distance = change[a];
+					jobs.configs[i].notify_distance = notify[b];
+					jobs.configs[i].reasonable_distance = reasonable[c];
+					jobs.configs[i].cue_lead_ms = lead[d];
+				}
+
+	jobs.runs = calloc(jobs.num_runs, sizeof(run_file));
+	pool_run(threads, jobs.num_runs, load_job, &jobs);
+
+	num_jobs = jobs.num_runs * jobs.num_routes * jobs.num_configs;
+	jobs.results = calloc(num_jobs, sizeof(sim_result));
+	if (pool_run(threads, num_jobs, sim_job, &jobs) != 0) {
+		fprintf(stderr, "fleet_sim: can't start worker threads\n");
+		return 1;
+	}
+
+	printf("route,run,change,notify,lead_ms,reasonable,fixes,reached,missed,cues,late_cues,"
+		"mean_lead_s,min_lead_s,max_lead_s,distance_m,complete\n");
+	for (i = 0; i < num_jobs; i++) {
+		uint32_t run = i / (jobs.num_routes * jobs.num_configs);
+		uint32_t rest = i % (jobs.num_routes * jobs.num_configs);
+		const nav_config* config = &jobs.configs[rest % jobs.num_configs];
+		const sim_result* r = &jobs.results[i];
+		uint16_t scored = r->scored;
+
+		if (!r->loaded)
+			continue;
+
+		printf("%s,%s,%u,%u,%u,%u,%u,%u,%u,%u,%u,%.2f,%.2f,%.2f,%u,%u\n",
+			jobs.routes[rest / jobs.num_configs].name, jobs.runs[run].name,
+			config->change_distance, config->notify_distance, config->cue_lead_ms,
+			config->reasonable_distance, r->fixes, r->reached, r->missed, r->cues,
+			r->late_cues, scored ? r->lead_sum / 1000.0 / scored : 0.0,
+			scored ? r->lead_min / 1000.0 : 0.0, scored ? r->lead_max / 1000.0 : 0.0,
+			r->distance, r->complete);
+	}
+
+	return 0;
+}
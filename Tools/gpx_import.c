@@ -0,0 +1,723 @@
+/*
+ * gpx_import.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Host GPX/KML route importer
+ *
+ * Converts the tracks exported by route planning tools into route files. The
+ * points of GPX tracks (trkseg) and routes (rte) and of KML LineString
+ * coordinates are read with a streaming scanner, so files of any size are read
+ * in fixed-size chunks. Each segment is then simplified with Douglas-Peucker,
+ * segments of all the files in parallel on a work-stealing thread pool.
+ *
+ * Sharp turns are found first (the course turns by more than the turn angle
+ * between the points a baseline before and after) and always kept, one point at
+ * the apex of each, so the watch has a waypoint to cue every turn at. The
+ * simplification runs between them. Each point kept records the largest
+ * tolerance it would survive, so a route still over the waypoints the watch can
+ * load (ROUTE_MAX_WAYPTS, or -n) is cut down by raising the tolerance without
+ * simplifying again.
+ *
+ * The route file of "Course 10k.gpx" is written as COURSE10.TXT (8.3, as the
+ * watch reads it from the card). Names are given out in the order of the input
+ * files, and a name already taken gets a ~N tail (COURSE~1.TXT), so no two inputs
+ * write the same file.
+ *
+ * Usage:
+ * 		gpx_import [-j threads] [-t tolerance_m] [-a turn_deg] [-n max_waypts]
+ * 			[-o out_dir] file ...
+ *
+ * Build:
+ * 		cc -O2 -pthread -I"../_Initial Code" -o gpx_import gpx_import.c route_file.c
+ * 			work_pool.c -lm
+ */
+
+#include <ctype.h>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "route_file.h"
+#include "route_lib.h"
+#include "work_pool.h"
+
+#define READ_CHUNK 65536		// bytes read at a time
+#define MAX_TAG 512				// longest tag kept (longer ones are skipped)
+#define MAX_NUMBER 64			// longest coordinate tuple kept
+#define TOLERANCE 5.0			// meters off the simplified line a point may be
+#define TURN_ANGLE TURN_INDICATE	// degrees of course change kept as a turn
+#define TURN_BASELINE 20.0		// meters before and after a point to measure its turn
+#define JOIN_DISTANCE 1.0		// meters between segment ends that are one point
+#define KEEP_ALWAYS FLT_MAX		// importance of the ends and turns
+
+// Points of one track segment
+typedef struct {
+	waypoint* points;
+	uint32_t count;
+	uint32_t size;
+	float* importance;		// largest tolerance each point is kept at (0 never)
+} segment;
+
+// One input file
+typedef struct {
+	const char* path;
+	segment* segments;
+	uint32_t num_segments;
+	uint32_t size;
+	uint32_t num_points;
+	int error;				// can't be read
+	// Result
+	char name[13];			// route file name
+	uint32_t num_waypts;	// waypoints written, 0 if no route file
+	float tolerance;		// tolerance the route was cut to
+} input_file;
+
+// Everything the jobs share
+typedef struct {
+	input_file* files;
+	uint32_t num_files;
+	segment** segments;		// all the segments of all the files
+	uint32_t num_segments;
+	float tolerance;
+	float turn_angle;
+	uint32_t max_waypts;	// waypoints a route is cut down to
+	const char* out_dir;
+} import_jobs;
+
+// State of the streaming scanner
+typedef struct {
+	input_file* file;
+	segment* open;			// segment points are added to, or NULL
+	char tag[MAX_TAG];
+	uint16_t tag_length;
+	uint8_t in_tag;
+	uint8_t in_comment;
+	uint8_t dashes;			// '-' seen in a row inside a comment
+	uint8_t in_coordinates;	// inside a KML coordinates element
+	char number[MAX_NUMBER];
+	uint8_t number_length;
+} scanner;
+
+/*
+ * Starts a new segment in the file
+ */
+static segment* open_segment(input_file* file) {
+	segment* s;
+
+	if (file->num_segments == file->size) {
+		file->size = file->size ? file->size * 2 : 4;
+		file->segments = realloc(file->segments, file->size * sizeof(segment));
+	}
+
+	s = &file->segments[file->num_segments++];
+	memset(s, 0, sizeof(*s));
+	return s;
+}
+
+/*
+ * Adds a point to the open segment (a point outside of any is dropped)
+ */
+static void add_point(scanner* sc, double latitude, double longitude) {
+	segment* s = sc->open;
+
+	if (s == NULL || latitude < -90 || latitude > 90 || longitude < -180 || longitude > 180)
+		return;
+
+	if (s->count == s->size) {
+		s->size = s->size ? s->size * 2 : 256;
+		s->points = realloc(s->points, s->size * sizeof(waypoint));
+	}
+
+	s->points[s->count].latitude = latitude;
+	s->points[s->count].longitude = longitude;
+	s->count++;
+	sc->file->num_points++;
+}
+
+/*
+ * Finds an attribute value in a tag
+ *
+ * return: pointer to the value after its opening quote, or NULL if missing
+ */
+static const char* find_attribute(const char* tag, const char* name) {
+	size_t length = strlen(name);
+	const char* p = tag;
+
+	while ((p = strstr(p, name)) != NULL) {
+		const char* q = p + length;
+
+		if (p > tag && isspace((unsigned char)p[-1])) {
+			while (isspace((unsigned char)*q))
+				q++;
+			if (*q == '=') {
+				q++;
+				while (isspace((unsigned char)*q))
+					q++;
+				if (*q == '"' || *q == '\'')
+					return q + 1;
+			}
+		}
+		p += length;
+	}
+
+	return NULL;
+}
+
+/*
+ * Parses one "lon,lat[,alt]" tuple of a KML coordinates element
+ */
+static void end_number(scanner* sc) {
+	double lat, lon;
+
+	if (sc->number_length == 0)
+		return;
+
+	sc->number[sc->number_length] = 0;
+	if (sscanf(sc->number, "%lf,%lf", &lon, &lat) == 2)
+		add_point(sc, lat, lon);
+	sc->number_length = 0;
+}
+
+/*
+ * Handles a complete tag (without its angle brackets)
+ */
+static void end_tag(scanner* sc) {
+	char* name = sc->tag;
+	char* colon;
+	uint8_t closing = 0;
+	size_t length;
+
+	sc->tag[sc->tag_length] = 0;
+	if (name[0] == '/') {
+		closing = 1;
+		name++;
+	}
+
+	// Drop any namespace prefix ("gpx:trkpt")
+	length = strcspn(name, " \t\r\n/");
+	colon = memchr(name, ':', length);
+	if (colon != NULL) {
+		length -= colon + 1 - name;
+		name = colon + 1;
+	}
+
+#define IS(tag) (length == sizeof(tag) - 1 && strncmp(name, tag, length) == 0)
+
+	if (IS("trkseg") || IS("rte")) {
+		if (!closing)
+			sc->open = open_segment(sc->file);
+		else
+			sc->open = NULL;
+	} else if (IS("trkpt") || IS("rtept")) {
+		const char* lat = find_attribute(sc->tag, "lat");
+		const char* lon = find_attribute(sc->tag, "lon");
+
+		if (!closing && lat != NULL && lon != NULL)
+			add_point(sc, atof(lat), atof(lon));
+	} else if (IS("coordinates")) {
+		if (!closing) {
+			sc->open = open_segment(sc->file);
+			sc->in_coordinates = 1;
+		} else {
+			end_number(sc);
+			sc->in_coordinates = 0;
+			sc->open = NULL;
+		}
+	}
+
+#undef IS
+}
+
+/*
+ * Feeds a chunk of the file to the scanner
+ */
+static void scan(scanner* sc, const char* data, size_t length) {
+	size_t i;
+
+	for (i = 0; i < length; i++) {
+		char c = data[i];
+
+		if (sc->in_comment) {
+			// A comment ends at "-->"
+			if (c == '>' && sc->dashes >= 2)
+				sc->in_comment = 0;
+			sc->dashes = (c == '-') ? sc->dashes + (sc->dashes < 2) : 0;
+		} else if (sc->in_tag) {
+			if (c == '>') {
+				sc->in_tag = 0;
+				if (sc->tag_length < MAX_TAG)
+					end_tag(sc);
+			} else if (sc->tag_length < MAX_TAG) {
+				sc->tag[sc->tag_length++] = c;
+				if (sc->tag_length == 3 && strncmp(sc->tag, "!--", 3) == 0) {
+					sc->in_tag = 0;
+					sc->in_comment = 1;
+					sc->dashes = 0;
+				}
+			}
+		} else if (c == '<') {
+			if (sc->in_coordinates)
+				end_number(sc);
+			sc->in_tag = 1;
+			sc->tag_length = 0;
+		} else if (sc->in_coordinates) {
+			if (isspace((unsigned char)c))
+				end_number(sc);
+			else if (sc->number_length < MAX_NUMBER - 1)
+				sc->number[sc->number_length++] = c;
+		}
+	}
+}
+
+/*
+ * Reads the segments of one file
+ */
+static void load_job(uint32_t job, void* arg) {
+	import_jobs* jobs = arg;
+	input_file* file = &jobs->files[job];
+	char* buffer = malloc(READ_CHUNK);
+	scanner sc;
+	FILE* f;
+	size_t n;
+
+	file->error = 1;
+	f = fopen(file->path, "rb");
+	if (f == NULL || buffer == NULL) {
+		if (f != NULL)
+			fclose(f);
+		free(buffer);
+		return;
+	}
+
+	memset(&sc, 0, sizeof(sc));
+	sc.file = file;
+	while ((n = fread(buffer, 1, READ_CHUNK, f)) > 0)
+		scan(&sc, buffer, n);
+
+	file->error = ferror(f) != 0;
+	fclose(f);
+	free(buffer);
+}
+
+/*
+ * Projects a segment onto a plane in meters (equirectangular about its first
+ * point, as the watch measures distances)
+ */
+static void project(const segment* s, float* x, float* y) {
+	double lon_scale = cos(s->points[0].latitude * DEG_TO_RAD) * DEG_TO_RAD * EARTH_RADIUS;
+	double lat_scale = DEG_TO_RAD * EARTH_RADIUS;
+	uint32_t i;
+
+	for (i = 0; i < s->count; i++) {
+		x[i] = (float)((s->points[i].longitude - s->points[0].longitude) * lon_scale);
+		y[i] = (float)((s->points[i].latitude - s->points[0].latitude) * lat_scale);
+	}
+}
+
+/*
+ * Gives the course change at each point in degrees, between the directions from
+ * the nearest point at least TURN_BASELINE before it and to the nearest one at
+ * least TURN_BASELINE after it (0 near the ends)
+ */
+static void turn_angles(const float* x, const float* y, uint32_t count, float* angle) {
+	uint32_t before = 0;
+	uint32_t after = 0;
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		float bx, by, ax, ay, cross, dot;
+
+		angle[i] = 0;
+
+		// Latest point still at least a baseline back
+		while (before + 1 < i && hypotf(x[i] - x[before + 1], y[i] - y[before + 1]) >=
+				TURN_BASELINE)
+			before++;
+		if (after < i)
+			after = i;
+		while (after < count && hypotf(x[after] - x[i], y[after] - y[i]) < TURN_BASELINE)
+			after++;
+
+		if (i == 0 || after == count || hypotf(x[i] - x[before], y[i] - y[before]) <
+				TURN_BASELINE)
+			continue;
+
+		bx = x[i] - x[before];
+		by = y[i] - y[before];
+		ax = x[after] - x[i];
+		ay = y[after] - y[i];
+		cross = bx * ay - by * ax;
+		dot = bx * ax + by * ay;
+		angle[i] = fabsf(atan2f(cross, dot)) * (float)RAD_TO_DEG;
+	}
+}
+
+/*
+ * Gives the distance from a point to the line through two others
+ */
+static float line_distance(const float* x, const float* y, uint32_t p, uint32_t a,
+		uint32_t b) {
+	float dx = x[b] - x[a];
+	float dy = y[b] - y[a];
+	float length = hypotf(dx, dy);
+
+	if (length == 0)
+		return hypotf(x[p] - x[a], y[p] - y[a]);
+
+	return fabsf(dx * (y[a] - y[p]) - dy * (x[a] - x[p])) / length;
+}
+
+/*
+ * Simplifies a segment: marks its ends and the apex of each sharp turn to keep,
+ * then runs Douglas-Peucker between them. A point split off at distance d under a
+ * split at distance p gets the importance min(d, p), the largest tolerance it
+ * would be kept at. The spans are kept on an explicit stack, a segment may have
+ * tens of thousands of points.
+ */
+static void simplify_job(uint32_t job, void* arg) {
+	import_jobs* jobs = arg;
+	segment* s = jobs->segments[job];
+	uint32_t count = s->count;
+	float* x = malloc(count * sizeof(float));
+	float* y = malloc(count * sizeof(float));
+	float* angle = malloc(count * sizeof(float));
+	uint32_t* stack = malloc(2 * count * sizeof(uint32_t));
+	uint32_t depth = 0;
+	uint32_t anchor = 0;
+	uint32_t last_apex = 0;
+	uint32_t i;
+
+	s->importance = calloc(count, sizeof(float));
+	if (count == 0 || x == NULL || y == NULL || angle == NULL || stack == NULL ||
+			s->importance == NULL)
+		goto done;
+
+	project(s, x, y);
+	turn_angles(x, y, count, angle);
+
+	// Ends, and the sharpest point of each run of points turning past the angle. Noise
+	// may break one turn into several runs, of apexes within a baseline of each
+	// other only the sharpest is kept.
+	s->importance[0] = s->importance[count - 1] = KEEP_ALWAYS;
+	for (i = 1; i < count; i++) {
+		uint32_t apex = i;
+
+		if (angle[i] < jobs->turn_angle)
+			continue;
+		for (; i < count && angle[i] >= jobs->turn_angle; i++)
+			if (angle[i] > angle[apex])
+				apex = i;
+
+		if (last_apex > 0 && hypotf(x[apex] - x[last_apex], y[apex] - y[last_apex]) <
+				TURN_BASELINE) {
+			if (angle[apex] <= angle[last_apex])
+				continue;
+			s->importance[last_apex] = 0;
+		}
+
+		s->importance[apex] = KEEP_ALWAYS;
+		last_apex = apex;
+	}
+
+	// Douglas-Peucker between each pair of kept points
+	for (i = 1; i < count; i++) {
+		if (s->importance[i] != KEEP_ALWAYS)
+			continue;
+
+		stack[depth++] = anchor;
+		stack[depth++] = i;
+		anchor = i;
+
+		while (depth > 0) {
+			uint32_t b = stack[--depth];
+			uint32_t a = stack[--depth];
+			float limit = (s->importance[a] < s->importance[b]) ? s->importance[a] :
+				s->importance[b];
+			float farthest = 0;
+			uint32_t split = a;
+			uint32_t p;
+
+			for (p = a + 1; p < b; p++) {
+				float d = line_distance(x, y, p, a, b);
+
+				if (d > farthest) {
+					farthest = d;
+					split = p;
+				}
+			}
+
+			if (farthest <= jobs->tolerance)
+				continue;
+
+			s->importance[split] = (farthest < limit) ? farthest : limit;
+			stack[depth++] = a;
+			stack[depth++] = split;
+			stack[depth++] = split;
+			stack[depth++] = b;
+		}
+	}
+
+done:
+	free(x);
+	free(y);
+	free(angle);
+	free(stack);
+}
+
+/*
+ * Tells whether two points are within JOIN_DISTANCE
+ */
+static int same_point(const waypoint* a, const waypoint* b) {
+	double x = (b->longitude - a->longitude) * cos(a->latitude * DEG_TO_RAD);
+	double y = b->latitude - a->latitude;
+
+	return sqrt(x * x + y * y) * DEG_TO_RAD * EARTH_RADIUS < JOIN_DISTANCE;
+}
+
+/*
+ * Orders importances from the largest
+ */
+static int compare_importance(const void* a, const void* b) {
+	float fa = *(const float*)a;
+	float fb = *(const float*)b;
+
+	return (fa < fb) - (fa > fb);
+}
+
+/*
+ * Gives the tolerance that keeps at most max points of a file, the given one if it
+ * does already
+ *
+ * return: the tolerance, or -1 if the turns alone are too many
+ */
+static float fit_tolerance(const input_file* file, float tolerance, uint32_t max) {
+	float* kept = malloc(file->num_points * sizeof(float));
+	uint32_t count = 0;
+	uint32_t i, j;
+
+	if (kept == NULL)
+		return -1;
+
+	for (i = 0; i < file->num_segments; i++)
+		for (j = 0; j < file->segments[i].count; j++)
+			if (file->segments[i].importance[j] > tolerance)
+				kept[count++] = file->segments[i].importance[j];
+
+	if (count > max) {
+		qsort(kept, count, sizeof(float), compare_importance);
+		tolerance = kept[max];
+		if (tolerance == KEEP_ALWAYS)
+			tolerance = -1;
+	}
+
+	free(kept);
+	return tolerance;
+}
+
+/*
+ * Writes the 8.3 route file name of an input file: the letters and digits of its
+ * name without the extension, upper case, at most 8, and ".TXT"
+ */
+static void route_name(const char* path, char* name) {
+	const char* base = strrchr(path, '/');
+	const char* dot;
+	uint8_t n = 0;
+
+	base = (base != NULL) ? base + 1 : path;
+	dot = strrchr(base, '.');
+	for (; *base != 0 && base != dot && n < 8; base++)
+		if (isalnum((unsigned char)*base))
+			name[n++] = (char)toupper((unsigned char)*base);
+
+	if (n == 0)
+		name[n++] = 'R';
+	strcpy(name + n, ".TXT");
+}
+
+/*
+ * Tells whether an earlier input file has been given a route file name
+ */
+static int name_taken(const import_jobs* jobs, uint32_t count, const char* name) {
+	uint32_t i;
+
+	for (i = 0; i < count; i++)
+		if (strcmp(jobs->files[i].name, name) == 0)
+			return 1;
+
+	return 0;
+}
+
+/*
+ * Gives every input file its route file name, in order. A name already taken is
+ * cut short for a ~N tail, N counting up until the name is free.
+ */
+static void assign_names(import_jobs* jobs) {
+	uint32_t i, n;
+
+	for (i = 0; i < jobs->num_files; i++) {
+		input_file* file = &jobs->files[i];
+		char tail[12];
+		size_t base;
+
+		route_name(file->path, file->name);
+		base = strcspn(file->name, ".");
+		for (n = 1; n <= 999999 && name_taken(jobs, i, file->name); n++) {
+			size_t length = (size_t)snprintf(tail, sizeof(tail), "~%u.TXT", n);
+			size_t keep = (base < 12 - length) ? base : 12 - length;
+
+			memcpy(file->name + keep, tail, length + 1);
+		}
+	}
+}
+
+/*
+ * Picks the points of one file to keep and writes its route file. The segments
+ * are joined in order, a segment starting where the last one ended adds its first
+ * point only once.
+ */
+static void write_job(uint32_t job, void* arg) {
+	import_jobs* jobs = arg;
+	input_file* file = &jobs->files[job];
+	waypoint route[MAX_WAYPTS];
+	char* path;
+	uint32_t count = 0;
+	float tolerance;
+	uint32_t i, j;
+	FILE* out;
+
+	if (file->error || file->num_points == 0) {
+		fprintf(stderr, "%s: can't read or no track points\n", file->path);
+		return;
+	}
+
+	tolerance = fit_tolerance(file, jobs->tolerance, jobs->max_waypts);
+	if (tolerance < 0) {
+		fprintf(stderr, "%s: more than %u sharp turns\n", file->path, jobs->max_waypts);
+		return;
+	}
+
+	for (i = 0; i < file->num_segments; i++) {
+		const segment* s = &file->segments[i];
+
+		for (j = 0; j < s->count; j++) {
+			if (s->importance[j] <= tolerance || count == jobs->max_waypts)
+				continue;
+			if (count > 0 && j == 0 && same_point(&route[count - 1], &s->points[j]))
+				continue;
+			route[count++] = s->points[j];
+		}
+	}
+
+	// The watch navigates routes of more than two waypoints (array_valid())
+	if (count <= 2) {
+		fprintf(stderr, "%s: fewer than 3 waypoints left\n", file->path);
+		return;
+	}
+
+	path = malloc(strlen(jobs->out_dir) + sizeof(file->name) + 1);
+	sprintf(path, "%s/%s", jobs->out_dir, file->name);
+
+	out = fopen(path, "w");
+	if (out == NULL) {
+		fprintf(stderr, "%s: can't write\n", path);
+		free(path);
+		return;
+	}
+
+	fprintf(out, "# %s: %u of %u points, tolerance %.1f m\n", file->path, count,
+		file->num_points, tolerance);
+	route_write(out, route, (uint16_t)count);
+	fclose(out);
+
+	file->num_waypts = count;
+	file->tolerance = tolerance;
+	free(path);
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: gpx_import [-j threads] [-t tolerance_m] [-a turn_deg] "
+		"[-n max_waypts] [-o out_dir] file ...\n");
+	exit(1);
+}
+
+int main(int argc, char** argv) {
+	import_jobs jobs;
+	unsigned threads = pool_default_threads();
+	int failed = 0;
+	uint32_t i, j, k;
+	int opt;
+
+	memset(&jobs, 0, sizeof(jobs));
+	jobs.tolerance = TOLERANCE;
+	jobs.turn_angle = TURN_ANGLE;
+	jobs.max_waypts = ROUTE_MAX_WAYPTS;
+	jobs.out_dir = ".";
+
+	while ((opt = getopt(argc, argv, "j:t:a:n:o:")) != -1) {
+		switch (opt) {
+			case 'j':
+				threads = (unsigned)atoi(optarg);
+				break;
+			case 't':
+				jobs.tolerance = (float)atof(optarg);
+				break;
+			case 'a':
+				jobs.turn_angle = (float)atof(optarg);
+				break;
+			case 'n':
+				jobs.max_waypts = (uint32_t)atoi(optarg);
+				break;
+			case 'o':
+				jobs.out_dir = optarg;
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if (optind == argc || threads == 0 || jobs.tolerance <= 0 || jobs.turn_angle <= 0 ||
+			jobs.max_waypts < 3 || jobs.max_waypts > MAX_WAYPTS)
+		usage();
+
+	jobs.num_files = argc - optind;
+	jobs.files = calloc(jobs.num_files, sizeof(input_file));
+	for (i = 0; i < jobs.num_files; i++)
+		jobs.files[i].path = argv[optind + i];
+
+	if (pool_run(threads, jobs.num_files, load_job, &jobs) != 0) {
+		fprintf(stderr, "gpx_import: can't start worker threads\n");
+		return 1;
+	}
+
+	// Every segment of every file is one simplification job
+	for (i = 0; i < jobs.num_files; i++)
+		jobs.num_segments += jobs.files[i].num_segments;
+	jobs.segments = malloc(jobs.num_segments * sizeof(segment*));
+	for (i = 0, k = 0; i < jobs.num_files; i++)
+		for (j = 0; j < jobs.files[i].num_segments; j++)
+			jobs.segments[k++] = &jobs.files[i].segments[j];
+
+	pool_run(threads, jobs.num_segments, simplify_job, &jobs);
+
+	assign_names(&jobs);
+	pool_run(threads, jobs.num_files, write_job, &jobs);
+
+	printf("file,route,points,waypoints,tolerance_m\n");
+	for (i = 0; i < jobs.num_files; i++) {
+		const input_file* file = &jobs.files[i];
+
+		if (file->num_waypts == 0) {
+			failed = 1;
+			continue;
+		}
+
+		printf("%s,%s,%u,%u,%.1f\n", file->path, file->name, file->num_points,
+			file->num_waypts, file->tolerance);
+	}
+
+	return failed;
+}
@@ -0,0 +1,626 @@
+/*
+ * ingest.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Host multi-device ingest daemon
+ *
+ * Takes NMEA streams from many watches at once, over a Unix socket, a TCP port on
+ * localhost, or from files, and writes the decoded fixes of each device in
+ * columnar form:
+ *
+ * 		out_dir/<device>/<session>-<stream>.<column>
+ *
+ * one raw little-endian array per column (see the columns table below), so a tool
+ * reading only times and positions never touches the rest. <session> is the local
+ * time the daemon started (yyyymmdd-hhmmss) and <stream> numbers the connections
+ * and files in the order they arrived, so a later run never adds to the files of
+ * an earlier one. A stream's files are truncated by its first write.
+ *
+ * The main thread accepts connections and deals them round-robin to one worker
+ * thread per core. Each worker runs its own epoll loop over its connections and
+ * keeps the parser state (nmea.c) of each, so a stream is only ever touched by
+ * one thread. Every connection has a fixed-size parser and column buffer, and
+ * data is read in fixed-size chunks, so memory grows only with the number of
+ * connections (capped by -m).
+ *
+ * Usage:
+ * 		ingest [-j workers] [-o out_dir] [-u socket_path] [-p tcp_port]
+ * 			[-m max_connections] [file ...]
+ *
+ * With no socket the daemon exits once the files are read, otherwise it runs until
+ * SIGINT or SIGTERM. A CSV line (device,stream,fixes,sentences,errors) is written to
+ * stdout as each stream ends.
+ *
+ * Build:
+ * 		cc -O2 -pthread -I"../_Initial Code" -o ingest ingest.c nmea.c work_pool.c -lm
+ */
+
+#define _GNU_SOURCE		// accept4()
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "nmea.h"
+#include "work_pool.h"
+
+#define READ_SIZE 4096			// bytes read from a stream at a time
+#define COLUMN_ROWS 256			// fixes buffered per stream before a write
+#define MAX_CONNECTIONS 512		// default cap on open streams
+#define MAX_EVENTS 64
+#define POLL_MS 200				// longest wait before checking for shutdown
+#define MAX_WORKERS 256
+
+// Decoded fixes of one stream waiting to be written, one array per column
+typedef struct {
+	uint32_t utc_ms[COLUMN_ROWS];
+	int32_t latitude[COLUMN_ROWS];		// microdegrees
+	int32_t longitude[COLUMN_ROWS];		// microdegrees
+	int16_t altitude[COLUMN_ROWS];		// meters
+	int8_t speed[COLUMN_ROWS];			// km/h
+	int16_t heading[COLUMN_ROWS];		// degrees
+	uint8_t satellites[COLUMN_ROWS];
+	uint8_t valid[COLUMN_ROWS];
+	uint16_t rows;
+} column_buffer;
+
+// Column files: name, array offset in column_buffer, bytes per row
+typedef struct {
+	const char* name;
+	size_t offset;
+	size_t size;
+} column_info;
+
+static const column_info columns[] = {
+	{ "utc_ms", offsetof(column_buffer, utc_ms), sizeof(uint32_t) },
+	{ "lat", offsetof(column_buffer, latitude), sizeof(int32_t) },
+	{ "lon", offsetof(column_buffer, longitude), sizeof(int32_t) },
+	{ "alt", offsetof(column_buffer, altitude), sizeof(int16_t) },
+	{ "speed", offsetof(column_buffer, speed), sizeof(int8_t) },
+	{ "heading", offsetof(column_buffer, heading), sizeof(int16_t) },
+	{ "sats", offsetof(column_buffer, satellites), sizeof(uint8_t) },
+	{ "valid", offsetof(column_buffer, valid), sizeof(uint8_t) },
+};
+#define NUM_COLUMNS (sizeof(columns) / sizeof(columns[0]))
+
+// One stream (socket or file)
+typedef struct connection {
+	int fd;
+	uint8_t is_file;
+	uint32_t stream;			// arrival number, names the output files
+	char device[NMEA_DEVICE_SIZE];
+	uint8_t write_failed;
+	uint8_t started;			// column files written to (later writes append)
+	uint64_t fixes;
+	nmea_parser parser;
+	column_buffer buffer;
+	struct connection* prev;	// worker's list of streams
+	struct connection* next;
+} connection;
+
+// One parser thread
+typedef struct {
+	pthread_t thread;
+	int epfd;
+	pthread_mutex_t lock;		// guards the stream lists
+	connection* sockets;		// streams watched by epoll
+	connection* files;			// streams read in turn (files can't be epolled)
+	uint8_t started;
+	char chunk[READ_SIZE];
+} worker;
+
+static const char* out_dir = ".";
+// Start time of the daemon, names the output files
+static char session[16];
+static worker* workers;
+static unsigned num_workers;
+static volatile sig_atomic_t stop;
+// Set when no more streams will arrive (files only, or shutting down)
+static volatile sig_atomic_t no_more_streams;
+static unsigned max_connections = MAX_CONNECTIONS;
+static unsigned open_connections;
+static pthread_mutex_t count_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void on_signal(int sig) {
+	(void)sig;
+	stop = 1;
+}
+
+/*
+ * Makes a device name safe to use as a directory name
+ */
+static void clean_name(char* name) {
+	char* c;
+
+	for (c = name; *c != 0; c++)
+		if (!((*c >= 'A' && *c <= 'Z') || (*c >= 'a' && *c <= 'z') ||
+				(*c >= '0' && *c <= '9') || *c == '-' || *c == '_'))
+			*c = '_';
+
+	if (name[0] == 0)
+		strcpy(name, "unknown");
+}
+
+/*
+ * Appends the buffered fixes of a stream to its column files
+ */
+static void flush_columns(connection* c) {
+	char path[512];
+	size_t i;
+
+	if (c->buffer.rows == 0 || c->write_failed) {
+		c->buffer.rows = 0;
+		return;
+	}
+
+	snprintf(path, sizeof(path), "%s/%s", out_dir, c->device);
+	if (mkdir(path, 0755) != 0 && errno != EEXIST)
+		c->write_failed = 1;
+
+	for (i = 0; i < NUM_COLUMNS && !c->write_failed; i++) {
+		const char* data = (const char*)&c->buffer + columns[i].offset;
+		size_t length = c->buffer.rows * columns[i].size;
+		int fd;
+
+		snprintf(path, sizeof(path), "%s/%s/%s-%u.%s", out_dir, c->device, session,
+			c->stream, columns[i].name);
+		fd = open(path, O_WRONLY | O_CREAT | (c->started ? O_APPEND : O_TRUNC), 0644);
+		if (fd < 0 || write(fd, data, length) != (ssize_t)length)
+			c->write_failed = 1;
+		if (fd >= 0)
+			close(fd);
+	}
+
+	if (c->write_failed)
+		fprintf(stderr, "ingest: can't write %s/%s, dropping its fixes\n", out_dir,
+			c->device);
+	else
+		c->started = 1;
+
+	c->buffer.rows = 0;
+}
+
+/*
+ * Adds a decoded fix to the stream's column buffer
+ */
+static void add_fix(connection* c, const gps_fix* fix) {
+	column_buffer* b = &c->buffer;
+	uint16_t row = b->rows;
+
+	b->utc_ms[row] = fix->utc_ms;
+	b->latitude[row] = (int32_t)lround(fix->latitude * 1000000.0);
+	b->longitude[row] = (int32_t)lround(fix->longitude * 1000000.0);
+	b->altitude[row] = fix->altitude;
+	b->speed[row] = fix->speed;
+	b->heading[row] = fix->heading;
+	b->satellites[row] = c->parser.satellites;
+	b->valid[row] = fix->valid;
+	c->fixes++;
+
+	if (++b->rows == COLUMN_ROWS)
+		flush_columns(c);
+}
+
+/*
+ * Runs a chunk of a stream through its parser
+ */
+static void parse_chunk(connection* c, const char* data, ssize_t length) {
+	ssize_t i;
+	gps_fix fix;
+
+	for (i = 0; i < length; i++) {
+		switch (nmea_feed(&c->parser, data[i], &fix)) {
+			case NMEA_FIX:
+				add_fix(c, &fix);
+				break;
+			case NMEA_DEVICE:
+				// Fixes so far stay under the old name
+				flush_columns(c);
+				strcpy(c->device, c->parser.device);
+				clean_name(c->device);
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+/*
+ * Gives the list of a worker a stream belongs on
+ */
+static connection** stream_list(worker* w, const connection* c) {
+	return c->is_file ? &w->files : &w->sockets;
+}
+
+/*
+ * Takes a stream off its worker's list
+ */
+static void unlink_stream(worker* w, connection* c) {
+	pthread_mutex_lock(&w->lock);
+	if (c->prev != NULL)
+		c->prev->next = c->next;
+	else
+		*stream_list(w, c) = c->next;
+	if (c->next != NULL)
+		c->next->prev = c->prev;
+	pthread_mutex_unlock(&w->lock);
+}
+
+/*
+ * Frees a stream and its place under the connection cap
+ */
+static void free_stream(connection* c) {
+	pthread_mutex_lock(&count_lock);
+	open_connections--;
+	pthread_mutex_unlock(&count_lock);
+
+	free(c);
+}
+
+/*
+ * Adds a stream to a worker. Sockets go in the worker's epoll set, files are read
+ * in turn between epoll waits.
+ *
+ * return: 0 on success, -1 if the socket can't be watched (the stream is freed)
+ */
+static int hand_over(worker* w, connection* c) {
+	connection** list;
+
+	pthread_mutex_lock(&w->lock);
+	list = stream_list(w, c);
+	c->prev = NULL;
+	c->next = *list;
+	if (*list != NULL)
+		(*list)->prev = c;
+	*list = c;
+	pthread_mutex_unlock(&w->lock);
+
+	if (!c->is_file) {
+		struct epoll_event event;
+
+		event.events = EPOLLIN | EPOLLRDHUP;
+		event.data.ptr = c;
+		if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, c->fd, &event) != 0) {
+			// The worker only walks the socket list at shutdown, it never saw it
+			unlink_stream(w, c);
+			close(c->fd);
+			free_stream(c);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Ends a stream: writes its last fixes, reports it and frees it. Only called by
+ * the stream's worker.
+ */
+static void close_stream(worker* w, connection* c) {
+	if (!c->is_file)
+		epoll_ctl(w->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+	close(c->fd);
+	flush_columns(c);
+
+	printf("%s,%u,%llu,%u,%u\n", c->device, c->stream, (unsigned long long)c->fixes,
+		c->parser.sentences, c->parser.errors);
+	fflush(stdout);
+
+	unlink_stream(w, c);
+	free_stream(c);
+}
+
+/*
+ * Reads one chunk of a stream
+ *
+ * return: 1 while the stream is open, 0 at its end
+ */
+static int read_stream(worker* w, connection* c) {
+	ssize_t length = read(c->fd, w->chunk, READ_SIZE);
+
+	if (length < 0)
+		return errno == EAGAIN || errno == EINTR;
+	if (length == 0)
+		return 0;
+
+	parse_chunk(c, w->chunk, length);
+	return 1;
+}
+
+/*
+ * Gives the first stream of a list
+ */
+static connection* first_stream(worker* w, connection** list) {
+	connection* c;
+
+	pthread_mutex_lock(&w->lock);
+	c = *list;
+	pthread_mutex_unlock(&w->lock);
+
+	return c;
+}
+
+/*
+ * Worker thread: parse the sockets as data arrives and the files a chunk at a time
+ */
+static void* worker_main(void* p) {
+	worker* w = p;
+	struct epoll_event events[MAX_EVENTS];
+	connection *c, *next;
+
+	for (;;) {
+		int n, i, have_files;
+
+		have_files = (first_stream(w, &w->files) != NULL);
+		if (stop || (no_more_streams && !have_files && first_stream(w, &w->sockets) == NULL))
+			break;
+
+		n = epoll_wait(w->epfd, events, MAX_EVENTS, have_files ? 0 : POLL_MS);
+		for (i = 0; i < n; i++) {
+			c = events[i].data.ptr;
+			if (!read_stream(w, c))
+				close_stream(w, c);
+		}
+
+		// One chunk of every file per pass, so files share the thread with sockets
+		for (c = first_stream(w, &w->files); c != NULL; c = next) {
+			pthread_mutex_lock(&w->lock);
+			next = c->next;
+			pthread_mutex_unlock(&w->lock);
+
+			if (!read_stream(w, c))
+				close_stream(w, c);
+		}
+	}
+
+	// Shutting down: keep what was received
+	while ((c = first_stream(w, &w->files)) != NULL)
+		close_stream(w, c);
+	while ((c = first_stream(w, &w->sockets)) != NULL)
+		close_stream(w, c);
+
+	return NULL;
+}
+
+/*
+ * Makes a stream and gives it to the next worker
+ *
+ * return: 0 on success, -1 if over the connection cap or out of memory
+ */
+static int add_stream(int fd, uint8_t is_file, const char* name) {
+	static uint32_t next_stream;
+	connection* c;
+
+	pthread_mutex_lock(&count_lock);
+	if (open_connections == max_connections) {
+		pthread_mutex_unlock(&count_lock);
+		close(fd);
+		return -1;
+	}
+	open_connections++;
+	pthread_mutex_unlock(&count_lock);
+
+	c = malloc(sizeof(*c));
+	if (c == NULL) {
+		close(fd);
+		pthread_mutex_lock(&count_lock);
+		open_connections--;
+		pthread_mutex_unlock(&count_lock);
+		return -1;
+	}
+
+	c->fd = fd;
+	c->is_file = is_file;
+	c->stream = next_stream++;
+	c->write_failed = 0;
+	c->started = 0;
+	c->fixes = 0;
+	c->buffer.rows = 0;
+	nmea_init(&c->parser);
+
+	if (name != NULL)
+		snprintf(c->device, sizeof(c->device), "%s", name);
+	else
+		snprintf(c->device, sizeof(c->device), "stream%u", c->stream);
+	clean_name(c->device);
+
+	return hand_over(&workers[c->stream % num_workers], c);
+}
+
+/*
+ * Opens a listening socket on a Unix path or a localhost TCP port
+ *
+ * return: the socket, or -1 on error
+ */
+static int listen_on(const char* path, int port) {
+	int fd, one = 1;
+
+	if (path != NULL) {
+		struct sockaddr_un addr;
+
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (strlen(path) >= sizeof(addr.sun_path))
+			return -1;
+		strcpy(addr.sun_path, path);
+		unlink(path);
+
+		fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+			goto fail;
+	} else {
+		struct sockaddr_in addr;
+
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons((uint16_t)port);
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (fd < 0)
+			return -1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+			goto fail;
+	}
+
+	if (listen(fd, SOMAXCONN) == 0)
+		return fd;
+
+fail:
+	if (fd >= 0)
+		close(fd);
+	return -1;
+}
+
+/*
+ * Gives a file name without directories or extension, for naming a file's device
+ */
+static void file_device(const char* path, char* name, size_t size) {
+	const char* base = strrchr(path, '/');
+
+	base = (base != NULL) ? base + 1 : path;
+	snprintf(name, size, "%s", base);
+	name[strcspn(name, ".")] = 0;
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: ingest [-j workers] [-o out_dir] [-u socket_path] "
+		"[-p tcp_port] [-m max_connections] [file ...]\n");
+	exit(2);
+}
+
+int main(int argc, char** argv) {
+	const char* socket_path = NULL;
+	struct epoll_event event, events[MAX_EVENTS];
+	struct sigaction action;
+	int listeners[2], num_listeners = 0;
+	int port = 0, epfd, opt, i;
+	time_t now = time(NULL);
+	unsigned w;
+
+	num_workers = pool_default_threads();
+	strftime(session, sizeof(session), "%Y%m%d-%H%M%S", localtime(&now));
+
+	while ((opt = getopt(argc, argv, "j:o:u:p:m:")) != -1) {
+		switch (opt) {
+			case 'j':
+				num_workers = (unsigned)atoi(optarg);
+				break;
+			case 'o':
+				out_dir = optarg;
+				break;
+			case 'u':
+				socket_path = optarg;
+				break;
+			case 'p':
+				port = atoi(optarg);
+				break;
+			case 'm':
+				max_connections = (unsigned)atoi(optarg);
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if (num_workers == 0 || num_workers > MAX_WORKERS || max_connections == 0 ||
+			(socket_path == NULL && port == 0 && optind == argc))
+		usage();
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = on_signal;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	if (mkdir(out_dir, 0755) != 0 && errno != EEXIST) {
+		fprintf(stderr, "ingest: can't make %s\n", out_dir);
+		return 1;
+	}
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (socket_path != NULL && (listeners[num_listeners++] = listen_on(socket_path, 0)) < 0) {
+		fprintf(stderr, "ingest: can't listen on %s\n", socket_path);
+		return 1;
+	}
+	if (port != 0 && (listeners[num_listeners++] = listen_on(NULL, port)) < 0) {
+		fprintf(stderr, "ingest: can't listen on port %d\n", port);
+		return 1;
+	}
+	for (i = 0; i < num_listeners; i++) {
+		event.events = EPOLLIN;
+		event.data.fd = listeners[i];
+		epoll_ctl(epfd, EPOLL_CTL_ADD, listeners[i], &event);
+	}
+
+	workers = calloc(num_workers, sizeof(worker));
+	if (epfd < 0 || workers == NULL)
+		return 1;
+
+	for (w = 0; w < num_workers; w++) {
+		pthread_mutex_init(&workers[w].lock, NULL);
+		workers[w].epfd = epoll_create1(EPOLL_CLOEXEC);
+		if (workers[w].epfd < 0 || pthread_create(&workers[w].thread, NULL, worker_main,
+				&workers[w]) != 0) {
+			fprintf(stderr, "ingest: can't start worker %u\n", w);
+			stop = 1;
+			break;
+		}
+		workers[w].started = 1;
+	}
+
+	for (i = optind; i < argc && !stop; i++) {
+		char name[NMEA_DEVICE_SIZE];
+		int fd = open(argv[i], O_RDONLY | O_CLOEXEC);
+
+		file_device(argv[i], name, sizeof(name));
+		if (fd < 0 || add_stream(fd, 1, name) != 0)
+			fprintf(stderr, "ingest: can't read %s\n", argv[i]);
+	}
+
+	if (num_listeners == 0)
+		no_more_streams = 1;
+
+	// Accept streams until told to stop
+	while (num_listeners > 0 && !stop) {
+		int n = epoll_wait(epfd, events, MAX_EVENTS, POLL_MS);
+
+		for (i = 0; i < n; i++) {
+			int fd;
+
+			while ((fd = accept4(events[i].data.fd, NULL, NULL,
+					SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+				if (add_stream(fd, 0, NULL) != 0)
+					fprintf(stderr, "ingest: stream refused (%u open)\n", max_connections);
+			}
+		}
+	}
+
+	no_more_streams = 1;
+	for (w = 0; w < num_workers; w++)
+		if (workers[w].started)
+			pthread_join(workers[w].thread, NULL);
+
+	for (i = 0; i < num_listeners; i++)
+		close(listeners[i]);
+	if (socket_path != NULL)
+		unlink(socket_path);
+
+	return 0;
+}
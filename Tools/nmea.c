@@ -0,0 +1,241 @@
+/*
+ * nmea.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Host-side NMEA parser
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "nmea.h"
+
+#define KNOTS_TO_KPH 1.852
+
+/*
+ * Resets a parser for a new stream
+ */
+void nmea_init(nmea_parser* p) {
+	memset(p, 0, sizeof(*p));
+}
+
+/*
+ * Gives the value of a hex digit, or -1
+ */
+static int hex_value(char c) {
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return -1;
+}
+
+/*
+ * Checks the checksum of a sentence and cuts it off
+ *
+ * return: 1 if the sentence has a good checksum, 0 otherwise
+ */
+static int check_sentence(char* line) {
+	char* star = strrchr(line, '*');
+	uint8_t sum = 0;
+	char* c;
+	int hi, lo;
+
+	if (star == NULL || (hi = hex_value(star[1])) < 0 || (lo = hex_value(star[2])) < 0)
+		return 0;
+
+	for (c = line + 1; c < star; c++)
+		sum ^= (uint8_t)*c;
+
+	*star = 0;
+	return sum == (uint8_t)(hi * 16 + lo);
+}
+
+/*
+ * Splits a sentence at its commas
+ *
+ * return: number of fields
+ */
+static int split_fields(char* line, char** fields) {
+	int count = 0;
+
+	fields[count++] = line;
+	while (count < NMEA_MAX_FIELDS && (line = strchr(line, ',')) != NULL) {
+		*line++ = 0;
+		fields[count++] = line;
+	}
+
+	return count;
+}
+
+/*
+ * Converts a time field "hhmmss.sss" to milliseconds of the day
+ *
+ * return: 0 on success, -1 if the field is malformed
+ */
+static int parse_time(const char* field, uint32_t* ms) {
+	double seconds;
+	int i;
+
+	for (i = 0; i < 6; i++)
+		if (field[i] < '0' || field[i] > '9')
+			return -1;
+
+	seconds = atof(field + 4);
+	*ms = ((field[0] - '0') * 10 + (field[1] - '0')) * 3600000UL +
+		((field[2] - '0') * 10 + (field[3] - '0')) * 60000UL +
+		(uint32_t)(seconds * 1000.0 + 0.5);
+
+	return 0;
+}
+
+/*
+ * Converts a "dddmm.mmmm" field and its hemisphere to decimal degrees
+ *
+ * return: 0 on success, -1 if the field is empty
+ */
+static int parse_degrees(const char* field, const char* hemisphere, double* degrees) {
+	double value;
+	int whole;
+
+	if (field[0] == 0)
+		return -1;
+
+	value = atof(field);
+	whole = (int)(value / 100);
+	*degrees = whole + (value - whole * 100) / 60.0;
+	if (hemisphere[0] == 'S' || hemisphere[0] == 'W')
+		*degrees = -*degrees;
+
+	return 0;
+}
+
+/*
+ * Keeps the altitude and satellites of a GGA for the RMC of the same time
+ */
+static void parse_gga(nmea_parser* p, char** fields, int count) {
+	if (count < 10 || parse_time(fields[1], &p->gga_ms) != 0) {
+		p->errors++;
+		return;
+	}
+
+	p->gga_satellites = (uint8_t)atoi(fields[7]);
+	p->gga_altitude = (int16_t)atoi(fields[9]);
+	p->have_gga = 1;
+	p->sentences++;
+}
+
+/*
+ * Makes a fix from an RMC
+ *
+ * return: NMEA_FIX, or NMEA_NONE if the sentence is malformed
+ */
+static nmea_result parse_rmc(nmea_parser* p, char** fields, int count, gps_fix* fix) {
+	if (count < 10 || parse_time(fields[1], &fix->utc_ms) != 0) {
+		p->errors++;
+		return NMEA_NONE;
+	}
+
+	fix->valid = (fields[2][0] == 'A') &&
+		parse_degrees(fields[3], fields[4], &fix->latitude) == 0 &&
+		parse_degrees(fields[5], fields[6], &fix->longitude) == 0;
+	if (!fix->valid)
+		fix->latitude = fix->longitude = 0;
+
+	fix->speed = (int8_t)(atof(fields[7]) * KNOTS_TO_KPH);
+	fix->heading = (int16_t)atoi(fields[8]);
+	fix->stamp = 0;
+
+	if (p->have_gga && p->gga_ms == fix->utc_ms) {
+		fix->altitude = p->gga_altitude;
+		p->satellites = p->gga_satellites;
+	} else {
+		fix->altitude = 0;
+		p->satellites = 0;
+	}
+	p->have_gga = 0;
+
+	p->sentences++;
+	return NMEA_FIX;
+}
+
+/*
+ * Parses one complete line
+ */
+static nmea_result parse_line(nmea_parser* p, gps_fix* fix) {
+	char* fields[NMEA_MAX_FIELDS];
+	const char* type;
+	int count;
+
+	if (strncmp(p->line, "#device ", 8) == 0) {
+		strncpy(p->device, p->line + 8, NMEA_DEVICE_SIZE - 1);
+		p->device[NMEA_DEVICE_SIZE - 1] = 0;
+		return NMEA_DEVICE;
+	}
+
+	if (p->line[0] != '$')
+		return NMEA_NONE;
+
+	if (!check_sentence(p->line)) {
+		p->errors++;
+		return NMEA_NONE;
+	}
+
+	count = split_fields(p->line, fields);
+	if (strlen(fields[0]) != 6) {
+		p->errors++;
+		return NMEA_NONE;
+	}
+
+	// "$ttSSS": skip the talker, any of GP, GN, GL, ...
+	type = fields[0] + 3;
+	if (strcmp(type, "GGA") == 0)
+		parse_gga(p, fields, count);
+	else if (strcmp(type, "RMC") == 0)
+		return parse_rmc(p, fields, count, fix);
+
+	return NMEA_NONE;
+}
+
+/*
+ * Feeds one byte of the stream to the parser
+ *
+ * c: next byte
+ * fix: filled when NMEA_FIX is returned
+ *
+ * return: what the byte completed
+ */
+nmea_result nmea_feed(nmea_parser* p, char c, gps_fix* fix) {
+	nmea_result result;
+
+	if (c == '\r')
+		return NMEA_NONE;
+
+	if (c != '\n') {
+		// A '$' always starts a new sentence, even after a lost line end
+		if (c == '$')
+			p->length = p->overflow = 0;
+
+		if (p->length == NMEA_MAX_LINE - 1)
+			p->overflow = 1;
+		else
+			p->line[p->length++] = c;
+
+		return NMEA_NONE;
+	}
+
+	p->line[p->length] = 0;
+
+	if (p->overflow) {
+		p->errors++;
+		result = NMEA_NONE;
+	} else {
+		result = parse_line(p, fix);
+	}
+
+	p->length = p->overflow = 0;
+	return result;
+}
@@ -0,0 +1,55 @@
+/*
+ * nmea.h
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Header for the host-side NMEA parser
+ *
+ * Does the job of uart_data_rx() and parse_data() in gps.c, but keeps all its
+ * state in an nmea_parser so any number of streams can be parsed at once. Bytes
+ * are fed one at a time. GGA and RMC sentences (any talker) with a good checksum
+ * are combined into gps_fix structures: a fix is given on every RMC, with the
+ * altitude of the GGA of the same time if one came before it.
+ *
+ * A stream may name its device with a line "#device <id>" before its sentences.
+ */
+
+#ifndef NMEA_H_
+#define NMEA_H_
+
+#include <stdint.h>
+#include "gps.h"
+
+#define NMEA_MAX_LINE 96		// longest line kept (NMEA allows 82 characters)
+#define NMEA_MAX_FIELDS 24
+#define NMEA_DEVICE_SIZE 32		// longest device name kept
+
+// What a byte completed
+typedef enum {
+	NMEA_NONE,				// nothing yet
+	NMEA_FIX,				// a fix is ready
+	NMEA_DEVICE				// the stream named its device
+} nmea_result;
+
+typedef struct {
+	char line[NMEA_MAX_LINE];
+	uint8_t length;
+	uint8_t overflow;			// line too long, skipped up to its end
+	char device[NMEA_DEVICE_SIZE];
+	// GGA waiting for the RMC of the same time
+	uint32_t gga_ms;
+	int16_t gga_altitude;
+	uint8_t gga_satellites;
+	uint8_t have_gga;
+	uint8_t satellites;			// of the last fix
+	uint32_t sentences;			// good sentences parsed
+	uint32_t errors;			// lines dropped (checksum, malformed, too long)
+} nmea_parser;
+
+// Reset a parser for a new stream
+void nmea_init(nmea_parser*);
+// Feed one byte, fills the fix when NMEA_FIX is returned
+nmea_result nmea_feed(nmea_parser*, char, gps_fix*);
+
+#endif	// NMEA_H_
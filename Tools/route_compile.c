@@ -0,0 +1,234 @@
+/*
+ * route_compile.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Host route compiler
+ *
+ * Compiles a route file into a C source with the tables of a route in program
+ * memory (see route_table.h), to build into the watch with -DHAVE_COURSE. The
+ * geometry is worked out with the watch's own navigation routines, from the
+ * waypoints rounded to microdegrees as the watch reads them.
+ *
+ * Usage:
+ * 		route_compile [-o source_file] route
+ *
+ * Build:
+ * 		cc -O2 -I"../_Initial Code" -o route_compile route_compile.c route_file.c
+ * 			sim_hw.c "../_Initial Code/navigation.c" "../_Initial Code/kalman.c"
+ * 			"../_Initial Code/run_stats.c" "../_Initial Code/heading.c"
+ * 			"../_Initial Code/ghost.c" "../_Initial Code/waypt_log.c"
+ * 			"../_Initial Code/route_table.c" "../_Initial Code/route_lib.c"
+ * 			"../_Initial Code/sd.c" "../_Initial Code/crc.c"
+ * 			"../_Initial Code/auto_pause.c" -lm
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "route_file.h"
+#include "route_table.h"
+
+static const char* turn_names[] = { "STRAIGHT", "LEFT", "RIGHT", "NONE" };
+
+/*
+ * Converts decimal degrees to microdegrees
+ */
+static int32_t to_udeg(double degrees) {
+	return (int32_t)lround(degrees * 1000000.0);
+}
+
+/*
+ * Orders index entries by cell, then leg
+ */
+static int compare_cells(const void* a, const void* b) {
+	const route_table_cell* ca = a;
+	const route_table_cell* cb = b;
+
+	if (ca->cell != cb->cell)
+		return (ca->cell > cb->cell) - (ca->cell < cb->cell);
+	return (int)ca->leg - (int)cb->leg;
+}
+
+/*
+ * Lists the grid cells covered by the bounding box of each leg
+ *
+ * count: set to the number of entries
+ *
+ * return: the entries sorted by cell (to free), or NULL if out of memory or too many
+ */
+static route_table_cell* index_legs(const route_table_point* points, uint8_t num_waypts,
+		uint16_t* count) {
+	route_table_cell* cells = NULL;
+	size_t size = 0;
+	size_t n = 0;
+	uint8_t leg;
+
+	for (leg = 0; leg + 1 < num_waypts; leg++) {
+		const route_table_point* a = &points[leg];
+		const route_table_point* b = &points[leg + 1];
+		uint32_t low = route_cell((a->latitude < b->latitude) ? a->latitude : b->latitude,
+			(a->longitude < b->longitude) ? a->longitude : b->longitude);
+		uint32_t high = route_cell((a->latitude > b->latitude) ? a->latitude : b->latitude,
+			(a->longitude > b->longitude) ? a->longitude : b->longitude);
+		uint32_t row, col;
+
+		for (row = low >> 16; row <= high >> 16; row++) {
+			for (col = low & 0xFFFF; col <= (high & 0xFFFF); col++) {
+				if (n == UINT16_MAX) {
+					free(cells);
+					return NULL;
+				}
+
+				if (n == size) {
+					route_table_cell* grown;
+
+					size = size ? size * 2 : 64;
+					grown = realloc(cells, size * sizeof(*cells));
+					if (grown == NULL) {
+						free(cells);
+						return NULL;
+					}
+					cells = grown;
+				}
+
+				cells[n].cell = (row << 16) | col;
+				cells[n].leg = leg;
+				n++;
+			}
+		}
+	}
+
+	qsort(cells, n, sizeof(*cells), compare_cells);
+	*count = (uint16_t)n;
+	return cells;
+}
+
+/*
+ * Fills the points of the table from a route
+ *
+ * return: the course length in meters
+ */
+static uint32_t make_points(const route_file* route, route_table_point* points) {
+	waypoint waypts[MAX_WAYPTS];
+	uint32_t length = 0;
+	uint8_t i;
+
+	for (i = 0; i < route->num_waypts; i++) {
+		points[i].latitude = to_udeg(route->waypts[i].latitude);
+		points[i].longitude = to_udeg(route->waypts[i].longitude);
+		waypts[i].latitude = points[i].latitude / 1000000.0;
+		waypts[i].longitude = points[i].longitude / 1000000.0;
+	}
+
+	for (i = 0; i < route->num_waypts; i++) {
+		points[i].leg_length = 0;
+		points[i].leg_bearing = 0;
+		points[i].turn = NONE;
+
+		if (i + 1 < route->num_waypts) {
+			points[i].leg_length = dist_between_waypts(&waypts[i], &waypts[i + 1]);
+			points[i].leg_bearing = bearing_to_waypt(&waypts[i], &waypts[i + 1]);
+			length += points[i].leg_length;
+		}
+
+		// The turn from the leg that ends at the waypoint to the one leaving it
+		if (i > 0 && i + 1 < route->num_waypts)
+			points[i].turn = direction_to_turn(points[i - 1].leg_bearing,
+				points[i].leg_bearing, 1);
+	}
+
+	return length;
+}
+
+/*
+ * Writes the generated source
+ */
+static void write_source(FILE* out, const route_file* route, const route_table_point* points,
+		const route_table_cell* cells, uint16_t num_cells, uint32_t length) {
+	uint16_t i;
+
+	fprintf(out, "/*\n * Course %s compiled by Tools/route_compile.c, do not edit\n *\n"
+		" * %u waypoints, %lu m\n */\n\n", route->name, route->num_waypts,
+		(unsigned long)length);
+	fprintf(out, "#include \"route_table.h\"\n\n");
+
+	fprintf(out, "static const route_table_point points[] PROGMEM = {\n");
+	for (i = 0; i < route->num_waypts; i++)
+		fprintf(out, "\t{ %ld, %ld, %u, %d, %s },\n", (long)points[i].latitude,
+			(long)points[i].longitude, points[i].leg_length, points[i].leg_bearing,
+			turn_names[points[i].turn]);
+	fprintf(out, "};\n\n");
+
+	fprintf(out, "static const route_table_cell cells[] PROGMEM = {\n");
+	for (i = 0; i < num_cells; i++)
+		fprintf(out, "\t{ 0x%08lXUL, %u },\n", (unsigned long)cells[i].cell, cells[i].leg);
+	fprintf(out, "};\n\n");
+
+	fprintf(out, "const route_table course PROGMEM = {\n\tpoints,\n\tcells,\n\t%u,\n\t%u,\n"
+		"\t%luUL,\n\t\"%s\"\n};\n", num_cells, route->num_waypts, (unsigned long)length,
+		route->name);
+}
+
+int main(int argc, char** argv) {
+	const char* out_path = "course.c";
+	route_table_point* points;
+	route_table_cell* cells;
+	route_file* route;
+	uint16_t num_cells;
+	uint32_t length;
+	FILE* out;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "o:")) != -1) {
+		switch (opt) {
+			case 'o':
+				out_path = optarg;
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-o source_file] route\n", argv[0]);
+				return 1;
+		}
+	}
+
+	if (optind != argc - 1) {
+		fprintf(stderr, "usage: %s [-o source_file] route\n", argv[0]);
+		return 1;
+	}
+
+	route = malloc(sizeof(*route));
+	points = malloc(MAX_WAYPTS * sizeof(*points));
+	if (route == NULL || points == NULL)
+		return 1;
+
+	if (route_load(argv[optind], route) != 0 || route->num_waypts <= 2 ||
+			strlen(route->name) >= ROUTE_NAME_SIZE || strchr(route->name, '"') != NULL) {
+		fprintf(stderr, "%s: not a route file of more than 2 waypoints or name longer "
+			"than %d characters\n", argv[optind], ROUTE_NAME_SIZE - 1);
+		return 1;
+	}
+
+	length = make_points(route, points);
+	cells = index_legs(points, route->num_waypts, &num_cells);
+	if (cells == NULL) {
+		fprintf(stderr, "%s: legs cover too many grid cells\n", argv[optind]);
+		return 1;
+	}
+
+	out = fopen(out_path, "w");
+	if (out == NULL) {
+		fprintf(stderr, "%s: can't write\n", out_path);
+		return 1;
+	}
+
+	write_source(out, route, points, cells, num_cells, length);
+	fclose(out);
+
+	free(cells);
+	free(points);
+	free(route);
+	return 0;
+}
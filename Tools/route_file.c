@@ -0,0 +1,69 @@
+/*
+ * route_file.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Reads and writes route files on the host
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "route_file.h"
+
+/*
+ * Loads a route file into a route structure
+ *
+ * path: file to read
+ * route: structure to fill
+ *
+ * return: 0 on success, -1 if the file can't be read, holds too many waypoints
+ * 		or has a malformed line
+ */
+int route_load(const char* path, route_file* route) {
+	char line[128];
+	const char* base = strrchr(path, '/');
+	FILE* f = fopen(path, "r");
+
+	if (f == NULL)
+		return -1;
+
+	base = (base != NULL) ? base + 1 : path;
+	strncpy(route->name, base, sizeof(route->name) - 1);
+	route->name[sizeof(route->name) - 1] = 0;
+	route->num_waypts = 0;
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		double lat, lon;
+
+		if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+			continue;
+
+		if (sscanf(line, "%lf,%lf", &lat, &lon) != 2 ||
+				route->num_waypts == MAX_WAYPTS) {
+			fclose(f);
+			return -1;
+		}
+
+		route->waypts[route->num_waypts].latitude = lat;
+		route->waypts[route->num_waypts].longitude = lon;
+		route->num_waypts++;
+	}
+
+	fclose(f);
+	return 0;
+}
+
+/*
+ * Writes waypoints in route file format
+ *
+ * f: output stream
+ * waypts: waypoints to write
+ * count: number of waypoints
+ */
+void route_write(FILE* f, const waypoint* waypts, uint16_t count) {
+	uint16_t i;
+
+	for (i = 0; i < count; i++)
+		fprintf(f, "%.6f,%.6f\n", waypts[i].latitude, waypts[i].longitude);
+}
@@ -0,0 +1,32 @@
+/*
+ * route_file.h
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Header for host-side route file reading and writing
+ *
+ * A route file is plain text with one "latitude,longitude" waypoint per line in
+ * decimal degrees. Blank lines and lines starting with '#' are ignored. This is
+ * the format the watch loads routes from.
+ */
+
+#ifndef ROUTE_FILE_H_
+#define ROUTE_FILE_H_
+
+#include <stdio.h>
+#include "navigation.h"
+
+// A route loaded from a file
+typedef struct {
+	char name[64];					// file name without directories
+	waypoint waypts[MAX_WAYPTS];
+	uint8_t num_waypts;
+} route_file;
+
+// Load a route file, returns 0 on success
+int route_load(const char*, route_file*);
+// Write waypoints in route file format
+void route_write(FILE*, const waypoint*, uint16_t);
+
+#endif	// ROUTE_FILE_H_
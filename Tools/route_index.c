@@ -0,0 +1,151 @@
+/*
+ * route_index.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Host route library index builder
+ *
+ * Reads route files and writes the index the watch loads at boot to pick a route
+ * from the first fix (see route_lib.h). The route files are copied to the root of
+ * the SD card next to the index under the same names.
+ *
+ * Usage:
+ * 		route_index [-o index_file] route ...
+ *
+ * Build:
+ * 		cc -O2 -I"../_Initial Code" -o route_index route_index.c route_file.c
+ * 			"../_Initial Code/route_lib.c" "../_Initial Code/sd.c"
+ * 			"../_Initial Code/crc.c" -lm
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "crc.h"
+#include "route_file.h"
+#include "route_lib.h"
+
+/*
+ * Converts decimal degrees to microdegrees
+ */
+static int32_t to_udeg(double degrees) {
+	return (int32_t)lround(degrees * 1000000.0);
+}
+
+/*
+ * Fills an index record from a loaded route
+ *
+ * return: 0 on success, -1 if the route is empty, longer than the watch can load
+ * 		or its name is too long
+ */
+static int make_record(const route_file* route, route_lib_record* record) {
+	uint16_t i;
+
+	if (route->num_waypts == 0 || route->num_waypts > ROUTE_MAX_WAYPTS ||
+			strlen(route->name) >= ROUTE_NAME_SIZE)
+		return -1;
+
+	memset(record, 0, sizeof(*record));
+	record->start_lat = record->min_lat = record->max_lat =
+		to_udeg(route->waypts[0].latitude);
+	record->start_lon = record->min_lon = record->max_lon =
+		to_udeg(route->waypts[0].longitude);
+	record->num_waypts = route->num_waypts;
+	strcpy(record->name, route->name);
+
+	for (i = 1; i < route->num_waypts; i++) {
+		int32_t lat = to_udeg(route->waypts[i].latitude);
+		int32_t lon = to_udeg(route->waypts[i].longitude);
+
+		if (lat < record->min_lat)
+			record->min_lat = lat;
+		if (lat > record->max_lat)
+			record->max_lat = lat;
+		if (lon < record->min_lon)
+			record->min_lon = lon;
+		if (lon > record->max_lon)
+			record->max_lon = lon;
+	}
+
+	return 0;
+}
+
+/*
+ * Orders records by the grid cell of their start point
+ */
+static int compare_cells(const void* a, const void* b) {
+	const route_lib_record* ra = a;
+	const route_lib_record* rb = b;
+	uint32_t ca = route_cell(ra->start_lat, ra->start_lon);
+	uint32_t cb = route_cell(rb->start_lat, rb->start_lon);
+
+	return (ca > cb) - (ca < cb);
+}
+
+int main(int argc, char** argv) {
+	const char* out_path = ROUTE_LIB_FILE;
+	route_lib_record records[ROUTE_LIB_MAX];
+	route_lib_header header;
+	route_file* route;
+	uint8_t count = 0;
+	FILE* out;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "o:")) != -1) {
+		switch (opt) {
+			case 'o':
+				out_path = optarg;
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-o index_file] route ...\n", argv[0]);
+				return 1;
+		}
+	}
+
+	if (optind == argc) {
+		fprintf(stderr, "no route files given\n");
+		return 1;
+	}
+
+	if (argc - optind > ROUTE_LIB_MAX) {
+		fprintf(stderr, "at most %d routes fit the watch's table\n", ROUTE_LIB_MAX);
+		return 1;
+	}
+
+	route = malloc(sizeof(*route));
+	if (route == NULL)
+		return 1;
+
+	for (i = optind; i < argc; i++) {
+		if (route_load(argv[i], route) != 0 || make_record(route, &records[count]) != 0) {
+			fprintf(stderr, "%s: not a route file, more than %d waypoints or name longer "
+				"than %d characters\n", argv[i], ROUTE_MAX_WAYPTS, ROUTE_NAME_SIZE - 1);
+			free(route);
+			return 1;
+		}
+		count++;
+	}
+	free(route);
+
+	qsort(records, count, sizeof(records[0]), compare_cells);
+
+	header.magic = ROUTE_LIB_MAGIC;
+	header.version = ROUTE_LIB_VERSION;
+	header.num_routes = count;
+	header.crc = crc16(CRC16_INIT, records, count * sizeof(records[0]));
+
+	out = fopen(out_path, "wb");
+	if (out == NULL || fwrite(&header, sizeof(header), 1, out) != 1 ||
+			fwrite(records, sizeof(records[0]), count, out) != count) {
+		fprintf(stderr, "%s: can't write\n", out_path);
+		if (out != NULL)
+			fclose(out);
+		return 1;
+	}
+
+	fclose(out);
+	return 0;
+}
@@ -0,0 +1,939 @@
+/*
+ * run_archive.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Host columnar run archive
+ *
+ * Collects recorded runs (run_file.h) into one archive file for fleet-wide
+ * queries. Each run is cut into chunks of ARCHIVE_CHUNK_ROWS valid fixes and each
+ * chunk stores its columns as separate arrays, with the smallest and largest value
+ * of every column (the zone map) in the chunk table:
+ *
+ * 		header | column arrays of every chunk | run table | chunk table
+ *
+ * The archive is memory mapped for queries. Runs are picked from the run table
+ * (route, device, month), chunks are skipped on their zone maps, and only the
+ * columns a query needs are read, so most pages of the file are never touched.
+ * The chunks left are scanned in parallel on a work-stealing thread pool.
+ *
+ * The run list names one recorded run per line, with the route, date and device
+ * it came from:
+ *
+ * 		path[,route[,yyyy-mm-dd[,device]]]
+ *
+ * Distance and the run summaries (moving time, elevation gain and loss) are worked
+ * out while building, with the watch's own statistics code (run_stats.c).
+ *
+ * Usage:
+ * 		run_archive build [-j threads] [-o archive] run_list
+ * 		run_archive query [-j threads] [-r route] [-d device] [-m yyyy-mm]
+ * 			[-b lat,lon,lat,lon] archive runs|stats|splits|box
+ *
+ * Queries:
+ * 		runs	the runs matching, with their summaries
+ * 		stats	totals and averages of the runs matching
+ * 		splits	average and best time of each kilometer (not with -b)
+ * 		box		time and distance spent inside the -b box
+ *
+ * Build:
+ * 		cc -O2 -pthread -I"../_Initial Code" -o run_archive run_archive.c run_file.c
+ * 			work_pool.c "../_Initial Code/run_stats.c" -lm
+ */
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "navigation.h"
+#include "run_file.h"
+#include "run_stats.h"
+#include "work_pool.h"
+
+#define ARCHIVE_MAGIC 0x43524152UL	// "RARC"
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_CHUNK_ROWS 1024		// fixes per chunk
+#define ARCHIVE_ALIGN 8				// column arrays start on this boundary
+
+// Columns, in file order within a chunk
+enum {
+	COL_TIME,		// run clock ms (uint32_t)
+	COL_LAT,		// microdegrees (int32_t)
+	COL_LON,		// microdegrees (int32_t)
+	COL_ALT,		// meters (int16_t)
+	COL_SPEED,		// km/h (uint8_t)
+	COL_DIST,		// cm run up to the fix (uint32_t)
+	NUM_COLUMNS
+};
+
+static const uint8_t column_size[NUM_COLUMNS] = { 4, 4, 4, 2, 1, 4 };
+
+// Start of the archive file
+typedef struct {
+	uint32_t magic;			// ARCHIVE_MAGIC
+	uint16_t version;		// ARCHIVE_VERSION
+	uint16_t num_columns;	// NUM_COLUMNS
+	uint32_t num_runs;
+	uint32_t num_chunks;
+	uint64_t runs_offset;	// run table
+	uint64_t chunks_offset;	// chunk table
+} archive_header;
+
+// One run in the run table
+typedef struct {
+	char name[64];			// run file name
+	char route[16];
+	char device[16];
+	uint32_t date;			// yyyymmdd, 0 if not known
+	uint32_t first_chunk;
+	uint32_t num_chunks;
+	uint32_t num_rows;
+	uint32_t distance;		// cm
+	uint32_t elapsed_ms;
+	uint32_t moving_ms;
+	uint16_t elevation_gain;	// meters
+	uint16_t elevation_loss;
+} archive_run;
+
+// Smallest and largest value of a column in a chunk
+typedef struct {
+	int32_t min;
+	int32_t max;
+} zone_map;
+
+// One chunk in the chunk table
+typedef struct {
+	uint32_t run;
+	uint32_t rows;
+	uint64_t offset[NUM_COLUMNS];	// column arrays
+	zone_map zones[NUM_COLUMNS];
+	uint32_t prev_time;		// time and distance of the last fix of the chunk before
+	uint32_t prev_dist;		// (of the first fix for the first chunk of a run)
+} archive_chunk;
+
+// A run loaded for building: its columns in memory
+typedef struct {
+	const char* path;
+	archive_run info;
+	uint32_t rows;
+	void* columns[NUM_COLUMNS];
+	int error;
+} build_run;
+
+typedef struct {
+	build_run* runs;
+	uint32_t num_runs;
+} build_jobs;
+
+// A mapped archive
+typedef struct {
+	const uint8_t* base;
+	size_t size;
+	const archive_header* header;
+	const archive_run* runs;
+	const archive_chunk* chunks;
+} archive;
+
+// What a query selects
+typedef struct {
+	const char* route;		// NULL for any
+	const char* device;
+	uint32_t month;			// yyyymm, 0 for any
+	uint8_t have_box;
+	int32_t box_lat[2];		// microdegrees, smallest first
+	int32_t box_lon[2];
+} query;
+
+// Result of scanning one chunk
+typedef struct {
+	uint32_t* split_km;		// kilometers completed in the chunk
+	uint32_t* split_ms;		// run time each was completed at
+	uint32_t num_splits;
+	uint64_t box_ms;		// time inside the box
+	uint64_t box_cm;		// distance inside the box
+} chunk_result;
+
+typedef struct {
+	const archive* a;
+	const query* q;
+	const uint32_t* chunks;	// chunks to scan
+	chunk_result* results;
+} query_jobs;
+
+/*
+ * Converts decimal degrees to microdegrees
+ */
+static int32_t to_udeg(double degrees) {
+	return (int32_t)lround(degrees * 1000000.0);
+}
+
+/*
+ * Gives the distance between two fixes in meters (equirectangular, as the watch)
+ */
+static double meters_apart(const gps_fix* a, const gps_fix* b) {
+	double x = (b->longitude - a->longitude) * cos((a->latitude + b->latitude) / 2 *
+		DEG_TO_RAD);
+	double y = b->latitude - a->latitude;
+
+	return sqrt(x * x + y * y) * DEG_TO_RAD * EARTH_RADIUS;
+}
+
+/*
+ * Pool job: loads one run and turns its valid fixes into columns
+ */
+static void load_job(uint32_t job, void* arg) {
+	build_jobs* jobs = arg;
+	build_run* r = &jobs->runs[job];
+	const gps_fix* last = NULL;
+	run_file run;
+	run_stats stats;
+	uint32_t distance = 0;
+	uint32_t i, c;
+
+	if (run_load(r->path, &run) != 0) {
+		r->error = 1;
+		return;
+	}
+
+	snprintf(r->info.name, sizeof(r->info.name), "%s", run.name);
+	for (c = 0; c < NUM_COLUMNS; c++) {
+		r->columns[c] = malloc((size_t)(run.num_fixes + 1) * column_size[c]);
+		if (r->columns[c] == NULL) {
+			r->error = 1;
+			run_free(&run);
+			return;
+		}
+	}
+
+	stats_init(&stats);
+	for (i = 0; i < run.num_fixes; i++) {
+		const gps_fix* f = &run.fixes[i];
+		uint32_t row = r->rows;
+
+		if (!f->valid)
+			continue;
+
+		if (last != NULL) {
+			double meters = meters_apart(last, f);
+			uint32_t ms = f->stamp - last->stamp;
+			uint16_t cm = (meters <= REASONABLE_DISTANCE) ? (uint16_t)(meters * 100) : 0;
+
+			distance += cm;
+			stats_update(&stats, cm, (ms < 65000) ? (uint16_t)ms : 65000,
+				f->speed / 3.6f, f->altitude);
+		}
+		last = f;
+
+		((uint32_t*)r->columns[COL_TIME])[row] = f->stamp;
+		((int32_t*)r->columns[COL_LAT])[row] = to_udeg(f->latitude);
+		((int32_t*)r->columns[COL_LON])[row] = to_udeg(f->longitude);
+		((int16_t*)r->columns[COL_ALT])[row] = f->altitude;
+		((uint8_t*)r->columns[COL_SPEED])[row] = (f->speed < 0) ? 0 : (uint8_t)f->speed;
+		((uint32_t*)r->columns[COL_DIST])[row] = distance;
+		r->rows++;
+	}
+
+	r->info.num_rows = r->rows;
+	r->info.distance = distance;
+	r->info.elapsed_ms = stats.elapsed_ms;
+	r->info.moving_ms = stats.moving_ms;
+	r->info.elevation_gain = stats.elevation_gain;
+	r->info.elevation_loss = stats.elevation_loss;
+	run_free(&run);
+}
+
+/*
+ * Gives a value of a column as a 32-bit integer
+ */
+static int32_t column_value(const void* column, uint8_t c, uint32_t row) {
+	switch (c) {
+		case COL_ALT:
+			return ((const int16_t*)column)[row];
+		case COL_SPEED:
+			return ((const uint8_t*)column)[row];
+		default:
+			return ((const int32_t*)column)[row];
+	}
+}
+
+/*
+ * Pads the file to the column alignment
+ */
+static uint64_t align_file(FILE* out, uint64_t offset) {
+	static const char zeros[ARCHIVE_ALIGN];
+	size_t pad = (size_t)((ARCHIVE_ALIGN - offset % ARCHIVE_ALIGN) % ARCHIVE_ALIGN);
+
+	fwrite(zeros, 1, pad, out);
+	return offset + pad;
+}
+
+/*
+ * Writes the chunks of one run and fills their table entries
+ *
+ * return: the file offset after the run
+ */
+static uint64_t write_run(FILE* out, uint64_t offset, const build_run* r, uint32_t run_index,
+		archive_chunk* chunks) {
+	uint32_t first, k = 0;
+	uint8_t c;
+
+	for (first = 0; first < r->rows; first += ARCHIVE_CHUNK_ROWS, k++) {
+		archive_chunk* chunk = &chunks[k];
+		uint32_t rows = r->rows - first;
+		uint32_t i;
+
+		if (rows > ARCHIVE_CHUNK_ROWS)
+			rows = ARCHIVE_CHUNK_ROWS;
+
+		chunk->run = run_index;
+		chunk->rows = rows;
+		// The run starts at its first valid fix, any time without a fix before it
+		// is not part of the first kilometer
+		chunk->prev_time = ((uint32_t*)r->columns[COL_TIME])[first ? first - 1 : 0];
+		chunk->prev_dist = ((uint32_t*)r->columns[COL_DIST])[first ? first - 1 : 0];
+
+		for (c = 0; c < NUM_COLUMNS; c++) {
+			const uint8_t* data = (const uint8_t*)r->columns[c] + (size_t)first * column_size[c];
+
+			chunk->zones[c].min = chunk->zones[c].max = column_value(r->columns[c], c, first);
+			for (i = first + 1; i < first + rows; i++) {
+				int32_t v = column_value(r->columns[c], c, i);
+
+				if (v < chunk->zones[c].min)
+					chunk->zones[c].min = v;
+				if (v > chunk->zones[c].max)
+					chunk->zones[c].max = v;
+			}
+
+			offset = align_file(out, offset);
+			chunk->offset[c] = offset;
+			fwrite(data, column_size[c], rows, out);
+			offset += (uint64_t)rows * column_size[c];
+		}
+	}
+
+	return offset;
+}
+
+/*
+ * Parses a "yyyy-mm-dd" date
+ *
+ * return: yyyymmdd, 0 if malformed
+ */
+static uint32_t parse_date(const char* text) {
+	unsigned year, month, day;
+
+	if (sscanf(text, "%4u-%2u-%2u", &year, &month, &day) != 3 || month < 1 || month > 12 ||
+			day < 1 || day > 31)
+		return 0;
+
+	return year * 10000 + month * 100 + day;
+}
+
+/*
+ * Reads the run list
+ *
+ * return: 0 on success, -1 if the file can't be read
+ */
+static int read_run_list(const char* path, build_jobs* jobs) {
+	char line[1024];
+	uint32_t capacity = 1024;
+	FILE* f = fopen(path, "r");
+
+	if (f == NULL)
+		return -1;
+
+	jobs->runs = calloc(capacity, sizeof(build_run));
+	while (fgets(line, sizeof(line), f) != NULL) {
+		char* field[4] = { NULL, NULL, NULL, NULL };
+		build_run* r;
+		int n = 0;
+		char* p;
+
+		line[strcspn(line, "\r\n")] = 0;
+		if (line[0] == 0 || line[0] == '#')
+			continue;
+
+		for (p = line; n < 4 && p != NULL; n++) {
+			field[n] = p;
+			if ((p = strchr(p, ',')) != NULL)
+				*p++ = 0;
+		}
+
+		if (jobs->num_runs == capacity) {
+			jobs->runs = realloc(jobs->runs, 2 * capacity * sizeof(build_run));
+			memset(jobs->runs + capacity, 0, capacity * sizeof(build_run));
+			capacity *= 2;
+		}
+
+		r = &jobs->runs[jobs->num_runs++];
+		r->path = strdup(field[0]);
+		if (field[1] != NULL)
+			strncpy(r->info.route, field[1], sizeof(r->info.route) - 1);
+		if (field[2] != NULL)
+			r->info.date = parse_date(field[2]);
+		if (field[3] != NULL)
+			strncpy(r->info.device, field[3], sizeof(r->info.device) - 1);
+	}
+
+	fclose(f);
+	return 0;
+}
+
+/*
+ * Builds an archive from a run list
+ */
+static int build(int argc, char** argv) {
+	const char* out_path = "runs.rar";
+	unsigned threads = pool_default_threads();
+	archive_header header;
+	archive_run* runs;
+	archive_chunk* chunks;
+	build_jobs jobs;
+	uint64_t offset;
+	uint32_t i, c, num_runs = 0, num_chunks = 0;
+	FILE* out;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "j:o:")) != -1) {
+		switch (opt) {
+			case 'j':
+				threads = (unsigned)atoi(optarg);
+				break;
+			case 'o':
+				out_path = optarg;
+				break;
+			default:
+				return 2;
+		}
+	}
+
+	memset(&jobs, 0, sizeof(jobs));
+	if (optind != argc - 1 || threads == 0)
+		return 2;
+	if (read_run_list(argv[optind], &jobs) != 0) {
+		fprintf(stderr, "run_archive: can't read run list %s\n", argv[optind]);
+		return 1;
+	}
+
+	if (pool_run(threads, jobs.num_runs, load_job, &jobs) != 0) {
+		fprintf(stderr, "run_archive: can't start worker threads\n");
+		return 1;
+	}
+
+	for (i = 0; i < jobs.num_runs; i++) {
+		if (jobs.runs[i].error)
+			fprintf(stderr, "run_archive: can't read run %s\n", jobs.runs[i].path);
+		else if (jobs.runs[i].rows > 0)
+			num_chunks += (jobs.runs[i].rows + ARCHIVE_CHUNK_ROWS - 1) / ARCHIVE_CHUNK_ROWS;
+	}
+
+	runs = calloc(jobs.num_runs + 1, sizeof(archive_run));
+	chunks = calloc(num_chunks + 1, sizeof(archive_chunk));
+	out = fopen(out_path, "wb");
+	if (out == NULL || runs == NULL || chunks == NULL) {
+		fprintf(stderr, "run_archive: can't write %s\n", out_path);
+		return 1;
+	}
+
+	// The header is written again once the tables are placed
+	memset(&header, 0, sizeof(header));
+	fwrite(&header, sizeof(header), 1, out);
+	offset = sizeof(header);
+
+	for (i = 0, num_chunks = 0; i < jobs.num_runs; i++) {
+		build_run* r = &jobs.runs[i];
+
+		if (r->error || r->rows == 0)
+			continue;
+
+		r->info.first_chunk = num_chunks;
+		r->info.num_chunks = (r->rows + ARCHIVE_CHUNK_ROWS - 1) / ARCHIVE_CHUNK_ROWS;
+		offset = write_run(out, offset, r, num_runs, &chunks[num_chunks]);
+		num_chunks += r->info.num_chunks;
+		runs[num_runs++] = r->info;
+
+		for (c = 0; c < NUM_COLUMNS; c++)
+			free(r->columns[c]);
+	}
+
+	offset = align_file(out, offset);
+	header.magic = ARCHIVE_MAGIC;
+	header.version = ARCHIVE_VERSION;
+	header.num_columns = NUM_COLUMNS;
+	header.num_runs = num_runs;
+	header.num_chunks = num_chunks;
+	header.runs_offset = offset;
+	header.chunks_offset = offset + (uint64_t)num_runs * sizeof(archive_run);
+
+	fwrite(runs, sizeof(archive_run), num_runs, out);
+	fwrite(chunks, sizeof(archive_chunk), num_chunks, out);
+	if (fseek(out, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, out) != 1 ||
+			fclose(out) != 0) {
+		fprintf(stderr, "run_archive: can't write %s\n", out_path);
+		return 1;
+	}
+
+	printf("%u runs, %u chunks\n", num_runs, num_chunks);
+	return 0;
+}
+
+/*
+ * Checks every run's chunks are in the chunk table and every chunk's columns lie
+ * within the file, so a truncated or damaged archive is refused before a query
+ * reads past the mapping
+ *
+ * return: 0 if the tables are sound, -1 otherwise
+ */
+static int check_tables(const archive* a) {
+	uint32_t i;
+	uint8_t c;
+
+	for (i = 0; i < a->header->num_runs; i++)
+		if ((uint64_t)a->runs[i].first_chunk + a->runs[i].num_chunks > a->header->num_chunks)
+			return -1;
+
+	for (i = 0; i < a->header->num_chunks; i++) {
+		const archive_chunk* chunk = &a->chunks[i];
+
+		if (chunk->run >= a->header->num_runs || chunk->rows == 0 ||
+				chunk->rows > ARCHIVE_CHUNK_ROWS)
+			return -1;
+
+		for (c = 0; c < NUM_COLUMNS; c++)
+			if (chunk->offset[c] % column_size[c] != 0 || chunk->offset[c] >= a->size ||
+					chunk->offset[c] + (uint64_t)chunk->rows * column_size[c] > a->size)
+				return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Maps an archive and checks its tables lie within the file
+ *
+ * return: 0 on success, -1 otherwise
+ */
+static int open_archive(const char* path, archive* a) {
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+	void* base;
+
+	if (fd < 0)
+		return -1;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(archive_header)) {
+		close(fd);
+		return -1;
+	}
+
+	base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED)
+		return -1;
+
+	a->base = base;
+	a->size = st.st_size;
+	a->header = base;
+	if (a->header->magic != ARCHIVE_MAGIC || a->header->version != ARCHIVE_VERSION ||
+			a->header->num_columns != NUM_COLUMNS ||
+			a->header->runs_offset + (uint64_t)a->header->num_runs * sizeof(archive_run) >
+				a->size ||
+			a->header->chunks_offset + (uint64_t)a->header->num_chunks *
+				sizeof(archive_chunk) > a->size) {
+		munmap(base, a->size);
+		return -1;
+	}
+
+	a->runs = (const archive_run*)(a->base + a->header->runs_offset);
+	a->chunks = (const archive_chunk*)(a->base + a->header->chunks_offset);
+	if (check_tables(a) != 0) {
+		munmap(base, a->size);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Gives a column array of a chunk
+ */
+static const void* column(const archive* a, const archive_chunk* chunk, uint8_t c) {
+	return a->base + chunk->offset[c];
+}
+
+/*
+ * Tells whether a run is selected by the query
+ */
+static int run_matches(const query* q, const archive_run* run) {
+	if (q->route != NULL && strncmp(run->route, q->route, sizeof(run->route)) != 0)
+		return 0;
+	if (q->device != NULL && strncmp(run->device, q->device, sizeof(run->device)) != 0)
+		return 0;
+	if (q->month != 0 && run->date / 100 != q->month)
+		return 0;
+	return 1;
+}
+
+/*
+ * Tells whether a chunk may have fixes inside the query box (from its zone map)
+ */
+static int chunk_in_box(const query* q, const archive_chunk* chunk) {
+	return chunk->zones[COL_LAT].max >= q->box_lat[0] &&
+		chunk->zones[COL_LAT].min <= q->box_lat[1] &&
+		chunk->zones[COL_LON].max >= q->box_lon[0] &&
+		chunk->zones[COL_LON].min <= q->box_lon[1];
+}
+
+/*
+ * Pool job: finds when each kilometer was completed in one chunk, interpolated
+ * between the fixes either side. Only the time and distance columns are read, and
+ * not at all when the zone map shows no kilometer ends in the chunk.
+ */
+static void splits_job(uint32_t job, void* arg) {
+	query_jobs* jobs = arg;
+	const archive_chunk* chunk = &jobs->a->chunks[jobs->chunks[job]];
+	chunk_result* result = &jobs->results[job];
+	uint32_t max = (uint32_t)chunk->zones[COL_DIST].max;
+	uint32_t next = (chunk->prev_dist / SPLIT_KM + 1) * SPLIT_KM;
+	uint32_t last_time = chunk->prev_time;
+	uint32_t last_dist = chunk->prev_dist;
+	const uint32_t* time;
+	const uint32_t* dist;
+	uint32_t i;
+
+	if (max < next)
+		return;
+
+	result->split_km = malloc(((max - chunk->prev_dist) / SPLIT_KM + 1) * sizeof(uint32_t));
+	result->split_ms = malloc(((max - chunk->prev_dist) / SPLIT_KM + 1) * sizeof(uint32_t));
+	time = column(jobs->a, chunk, COL_TIME);
+	dist = column(jobs->a, chunk, COL_DIST);
+
+	for (i = 0; i < chunk->rows; i++) {
+		// Never past the zone map the arrays are sized from, even in a damaged file
+		while (dist[i] >= next && next <= max) {
+			result->split_km[result->num_splits] = next / SPLIT_KM;
+			result->split_ms[result->num_splits] = last_time + (uint32_t)((double)(time[i] -
+				last_time) * (next - last_dist) / (dist[i] - last_dist));
+			result->num_splits++;
+			next += SPLIT_KM;
+		}
+		last_time = time[i];
+		last_dist = dist[i];
+	}
+}
+
+/*
+ * Pool job: adds up the time and distance between fixes that end inside the box.
+ * A chunk wholly inside the box (by its zone map) is worked out from its last fix.
+ */
+static void box_job(uint32_t job, void* arg) {
+	query_jobs* jobs = arg;
+	const query* q = jobs->q;
+	const archive_chunk* chunk = &jobs->a->chunks[jobs->chunks[job]];
+	chunk_result* result = &jobs->results[job];
+	const uint32_t* time = column(jobs->a, chunk, COL_TIME);
+	const uint32_t* dist = column(jobs->a, chunk, COL_DIST);
+	const int32_t* lat;
+	const int32_t* lon;
+	uint32_t i;
+
+	if (chunk->zones[COL_LAT].min >= q->box_lat[0] && chunk->zones[COL_LAT].max <= q->box_lat[1] &&
+			chunk->zones[COL_LON].min >= q->box_lon[0] &&
+			chunk->zones[COL_LON].max <= q->box_lon[1]) {
+		result->box_ms = time[chunk->rows - 1] - chunk->prev_time;
+		result->box_cm = dist[chunk->rows - 1] - chunk->prev_dist;
+		return;
+	}
+
+	lat = column(jobs->a, chunk, COL_LAT);
+	lon = column(jobs->a, chunk, COL_LON);
+	for (i = 0; i < chunk->rows; i++) {
+		if (lat[i] < q->box_lat[0] || lat[i] > q->box_lat[1] ||
+				lon[i] < q->box_lon[0] || lon[i] > q->box_lon[1])
+			continue;
+
+		result->box_ms += time[i] - (i ? time[i - 1] : chunk->prev_time);
+		result->box_cm += dist[i] - (i ? dist[i - 1] : chunk->prev_dist);
+	}
+}
+
+/*
+ * Prints the runs selected
+ */
+static void print_runs(const archive* a, const query* q) {
+	uint32_t i;
+
+	printf("run,route,device,date,fixes,distance_m,elapsed_s,moving_s,pace_s_km,gain_m,"
+		"loss_m\n");
+	for (i = 0; i < a->header->num_runs; i++) {
+		const archive_run* r = &a->runs[i];
+
+		if (!run_matches(q, r))
+			continue;
+
+		printf("%.64s,%.16s,%.16s,%u,%u,%u,%u,%u,%u,%u,%u\n", r->name, r->route, r->device,
+			r->date, r->num_rows, r->distance / 100, r->elapsed_ms / 1000,
+			r->moving_ms / 1000, r->distance ? (uint32_t)((uint64_t)r->moving_ms *
+			100 / r->distance) : 0, r->elevation_gain, r->elevation_loss);
+	}
+}
+
+/*
+ * Prints the totals of the runs selected (from the run table alone)
+ */
+static void print_stats(const archive* a, const query* q) {
+	uint64_t distance = 0, elapsed = 0, moving = 0, gain = 0, loss = 0;
+	uint32_t runs = 0;
+	uint32_t i;
+
+	for (i = 0; i < a->header->num_runs; i++) {
+		const archive_run* r = &a->runs[i];
+
+		if (!run_matches(q, r))
+			continue;
+
+		runs++;
+		distance += r->distance;
+		elapsed += r->elapsed_ms;
+		moving += r->moving_ms;
+		gain += r->elevation_gain;
+		loss += r->elevation_loss;
+	}
+
+	printf("runs,distance_km,elapsed_h,average_distance_km,average_pace_s_km,"
+		"average_gain_m,average_loss_m\n");
+	printf("%u,%.1f,%.1f,%.2f,%.0f,%.1f,%.1f\n", runs, distance / 1e5, elapsed / 3.6e6,
+		runs ? distance / 1e5 / runs : 0.0, distance ? moving * 100.0 / distance : 0.0,
+		runs ? (double)gain / runs : 0.0, runs ? (double)loss / runs : 0.0);
+}
+
+/*
+ * Prints the average and best time of each kilometer from the chunk results. The
+ * chunks of a run are in order, so a run's splits come in order too.
+ */
+static void print_splits(const archive* a, const uint32_t* chunks, uint32_t count,
+		const chunk_result* results) {
+	uint64_t* sum = NULL;
+	uint32_t* runs = NULL;
+	uint32_t* best = NULL;
+	uint32_t max_km = 0;
+	uint32_t run = UINT32_MAX;
+	uint32_t last_ms = 0;
+	uint32_t i, j;
+
+	for (i = 0; i < count; i++) {
+		const chunk_result* r = &results[i];
+
+		if (a->chunks[chunks[i]].run != run) {
+			run = a->chunks[chunks[i]].run;
+			last_ms = a->chunks[a->runs[run].first_chunk].prev_time;	// first valid fix
+		}
+
+		for (j = 0; j < r->num_splits; j++) {
+			uint32_t km = r->split_km[j];
+			uint32_t ms = r->split_ms[j] - last_ms;
+
+			if (km > max_km) {
+				sum = realloc(sum, km * sizeof(uint64_t));
+				runs = realloc(runs, km * sizeof(uint32_t));
+				best = realloc(best, km * sizeof(uint32_t));
+				memset(sum + max_km, 0, (km - max_km) * sizeof(uint64_t));
+				memset(runs + max_km, 0, (km - max_km) * sizeof(uint32_t));
+				memset(best + max_km, 0xFF, (km - max_km) * sizeof(uint32_t));
+				max_km = km;
+			}
+
+			sum[km - 1] += ms;
+			runs[km - 1]++;
+			if (ms < best[km - 1])
+				best[km - 1] = ms;
+			last_ms = r->split_ms[j];
+		}
+	}
+
+	printf("km,runs,average_s,best_s\n");
+	for (i = 0; i < max_km; i++)
+		if (runs[i] > 0)
+			printf("%u,%u,%.1f,%.1f\n", i + 1, runs[i], sum[i] / 1000.0 / runs[i],
+				best[i] / 1000.0);
+
+	free(sum);
+	free(runs);
+	free(best);
+}
+
+/*
+ * Prints the time and distance inside the box from the chunk results
+ */
+static void print_box(const archive* a, const uint32_t* chunks, uint32_t count,
+		const chunk_result* results) {
+	uint64_t ms = 0, cm = 0;
+	uint32_t runs = 0;
+	uint32_t run = UINT32_MAX;
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		if (results[i].box_ms == 0 && results[i].box_cm == 0)
+			continue;
+		if (a->chunks[chunks[i]].run != run) {
+			run = a->chunks[chunks[i]].run;
+			runs++;
+		}
+		ms += results[i].box_ms;
+		cm += results[i].box_cm;
+	}
+
+	printf("runs,time_s,distance_m,average_time_s\n");
+	printf("%u,%.1f,%.1f,%.1f\n", runs, ms / 1000.0, cm / 100.0,
+		runs ? ms / 1000.0 / runs : 0.0);
+}
+
+/*
+ * Parses a "lat,lon,lat,lon" box
+ *
+ * return: 0 on success, -1 if malformed
+ */
+static int parse_box(const char* text, query* q) {
+	double lat1, lon1, lat2, lon2;
+
+	if (sscanf(text, "%lf,%lf,%lf,%lf", &lat1, &lon1, &lat2, &lon2) != 4)
+		return -1;
+
+	q->box_lat[0] = to_udeg(fmin(lat1, lat2));
+	q->box_lat[1] = to_udeg(fmax(lat1, lat2));
+	q->box_lon[0] = to_udeg(fmin(lon1, lon2));
+	q->box_lon[1] = to_udeg(fmax(lon1, lon2));
+	q->have_box = 1;
+	return 0;
+}
+
+/*
+ * Runs a query on an archive
+ */
+static int run_query(int argc, char** argv) {
+	unsigned threads = pool_default_threads();
+	const char* kind;
+	query_jobs jobs;
+	uint32_t* chunks;
+	uint32_t count = 0;
+	uint32_t i, k;
+	unsigned year, month;
+	archive a;
+	query q;
+	int opt;
+
+	memset(&q, 0, sizeof(q));
+	while ((opt = getopt(argc, argv, "j:r:d:m:b:")) != -1) {
+		switch (opt) {
+			case 'j':
+				threads = (unsigned)atoi(optarg);
+				break;
+			case 'r':
+				q.route = optarg;
+				break;
+			case 'd':
+				q.device = optarg;
+				break;
+			case 'm':
+				if (sscanf(optarg, "%4u-%2u", &year, &month) != 2 || month < 1 || month > 12)
+					return 2;
+				q.month = year * 100 + month;
+				break;
+			case 'b':
+				if (parse_box(optarg, &q) != 0)
+					return 2;
+				break;
+			default:
+				return 2;
+		}
+	}
+
+	if (optind != argc - 2 || threads == 0)
+		return 2;
+
+	kind = argv[optind + 1];
+	if (open_archive(argv[optind], &a) != 0) {
+		fprintf(stderr, "run_archive: %s is not an archive or is damaged\n", argv[optind]);
+		return 1;
+	}
+
+	if (strcmp(kind, "runs") == 0) {
+		print_runs(&a, &q);
+		return 0;
+	}
+	if (strcmp(kind, "stats") == 0) {
+		print_stats(&a, &q);
+		return 0;
+	}
+	// A split spans chunks, so splits can't skip chunks outside a box
+	if (strcmp(kind, "splits") == 0 ? q.have_box : (strcmp(kind, "box") != 0 || !q.have_box))
+		return 2;
+
+	// Chunks of the runs selected, less those outside the box for a box query
+	chunks = malloc((a.header->num_chunks + 1) * sizeof(uint32_t));
+	for (i = 0; i < a.header->num_runs; i++) {
+		const archive_run* r = &a.runs[i];
+
+		if (!run_matches(&q, r))
+			continue;
+
+		for (k = r->first_chunk; k < r->first_chunk + r->num_chunks; k++)
+			if (!q.have_box || chunk_in_box(&q, &a.chunks[k]))
+				chunks[count++] = k;
+	}
+
+	jobs.a = &a;
+	jobs.q = &q;
+	jobs.chunks = chunks;
+	jobs.results = calloc(count + 1, sizeof(chunk_result));
+	if (pool_run(threads, count, (kind[0] == 's') ? splits_job : box_job, &jobs) != 0) {
+		fprintf(stderr, "run_archive: can't start worker threads\n");
+		return 1;
+	}
+
+	if (kind[0] == 's')
+		print_splits(&a, chunks, count, jobs.results);
+	else
+		print_box(&a, chunks, count, jobs.results);
+
+	for (i = 0; i < count; i++) {
+		free(jobs.results[i].split_km);
+		free(jobs.results[i].split_ms);
+	}
+	free(jobs.results);
+	free(chunks);
+	munmap((void*)a.base, a.size);
+	return 0;
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: run_archive build [-j threads] [-o archive] run_list\n"
+		"       run_archive query [-j threads] [-r route] [-d device] [-m yyyy-mm]\n"
+		"           [-b lat,lon,lat,lon] archive runs|stats|splits|box\n");
+	exit(2);
+}
+
+int main(int argc, char** argv) {
+	int result;
+
+	if (argc < 2)
+		usage();
+
+	// The options follow the subcommand
+	if (strcmp(argv[1], "build") == 0)
+		result = build(argc - 1, argv + 1);
+	else if (strcmp(argv[1], "query") == 0)
+		result = run_query(argc - 1, argv + 1);
+	else
+		result = 2;
+
+	if (result == 2)
+		usage();
+	return result;
+}
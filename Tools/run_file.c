@@ -0,0 +1,93 @@
+/*
+ * run_file.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Reads recorded run files on the host
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "clock.h"
+#include "run_file.h"
+
+/*
+ * Loads a recorded run into memory
+ *
+ * path: file to read
+ * run: structure to fill, free with run_free()
+ *
+ * return: 0 on success, -1 if the file can't be read or is malformed
+ */
+int run_load(const char* path, run_file* run) {
+	char line[160];
+	uint32_t capacity = 1024;
+	const char* base = strrchr(path, '/');
+	FILE* f = fopen(path, "r");
+
+	if (f == NULL)
+		return -1;
+
+	base = (base != NULL) ? base + 1 : path;
+	strncpy(run->name, base, sizeof(run->name) - 1);
+	run->name[sizeof(run->name) - 1] = 0;
+	run->num_fixes = 0;
+	run->fixes = malloc(capacity * sizeof(gps_fix));
+
+	while (run->fixes != NULL && fgets(line, sizeof(line), f) != NULL) {
+		double time;
+		int alt, speed, heading, fix;
+		gps_fix* p;
+
+		if (isalpha((unsigned char)line[0]) || line[0] == '#' || line[0] == '\n')
+			continue;
+
+		if (run->num_fixes == capacity) {
+			gps_fix* grown = realloc(run->fixes, 2 * capacity * sizeof(gps_fix));
+			if (grown == NULL)
+				break;
+			run->fixes = grown;
+			capacity *= 2;
+		}
+
+		p = &run->fixes[run->num_fixes];
+		if (sscanf(line, "%lf,%lf,%lf,%d,%d,%d,%d", &time, &p->latitude,
+				&p->longitude, &alt, &speed, &heading, &fix) != 7) {
+			run_free(run);
+			fclose(f);
+			return -1;
+		}
+
+		p->utc_ms = (uint32_t)(time * 1000.0 + 0.5) % MS_PER_DAY;
+		// The run clock starts at the first fix and carries on over midnight
+		if (run->num_fixes == 0)
+			p->stamp = 0;
+		else
+			p->stamp = p[-1].stamp +
+				(p->utc_ms + MS_PER_DAY - p[-1].utc_ms) % MS_PER_DAY;
+		p->altitude = (int16_t)alt;
+		p->speed = (int8_t)speed;
+		p->heading = (int16_t)heading;
+		p->valid = (uint8_t)(fix == 1);
+		run->num_fixes++;
+	}
+
+	fclose(f);
+
+	if (run->fixes == NULL)
+		return -1;
+
+	return 0;
+}
+
+/*
+ * Frees the fixes of a loaded run
+ */
+void run_free(run_file* run) {
+	free(run->fixes);
+	run->fixes = NULL;
+	run->num_fixes = 0;
+}
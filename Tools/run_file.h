@@ -0,0 +1,36 @@
+/*
+ * run_file.h
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Header for host-side recorded run files
+ *
+ * A recorded run is a CSV file with one GPS fix per line:
+ *
+ * 		time,latitude,longitude,altitude,speed,heading,fix
+ *
+ * where time is UTC seconds of the day (fractions allowed), speed is in km/h and
+ * fix is 1 for a valid fix. Fixes are stamped with a run clock that starts at 0 on
+ * the first fix, as on the device. A first line starting with a letter is treated as a header.
+ */
+
+#ifndef RUN_FILE_H_
+#define RUN_FILE_H_
+
+#include <stdint.h>
+#include "gps.h"
+
+// A recorded run loaded from a file
+typedef struct {
+	char name[64];		// file name without directories
+	gps_fix* fixes;
+	uint32_t num_fixes;
+} run_file;
+
+// Load a recorded run, returns 0 on success
+int run_load(const char*, run_file*);
+// Free the fixes of a loaded run
+void run_free(run_file*);
+
+#endif	// RUN_FILE_H_
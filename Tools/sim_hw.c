@@ -0,0 +1,84 @@
+/*
+ * sim_hw.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Host stand-ins for the device routines the navigation code calls
+ *
+ * The simulation tools drive nav_update() directly with recorded fixes, so the
+ * GPS and motor routines used by navigate_route() never do anything here.
+ */
+
+#include "navigation.h"
+#include "display.h"
+#include "eeprom_log.h"
+
+uint8_t gps_data_ready() {
+	return 0;
+}
+
+uint8_t update_gps() {
+	return 0;
+}
+
+void get_fix(gps_fix* fix) {
+	fix->valid = 0;
+}
+
+void vibrate_left() {
+}
+
+void vibrate_right() {
+}
+
+void vibrate_both() {
+}
+
+void vibrate_off() {
+}
+
+void pulse_motors(uint16_t ms) {
+	(void)ms;
+}
+
+uint8_t ee_log_save(const run_summary* summary) {
+	(void)summary;
+	return 0;
+}
+
+uint8_t is_fix_valid() {
+	return 0;
+}
+
+void display_time(uint32_t ms) {
+	(void)ms;
+}
+
+void display_distance(uint32_t cm) {
+	(void)cm;
+}
+
+void display_pace(uint16_t pace) {
+	(void)pace;
+}
+
+void display_status(const char* text) {
+	(void)text;
+}
+
+void display_turn(char arrow) {
+	(void)arrow;
+}
+
+uint8_t gps_save_aiding() {
+	return 0;
+}
+
+uint8_t get_satellites() {
+	return 0;
+}
+
+uint8_t gps_aided() {
+	return 0;
+}
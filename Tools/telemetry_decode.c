@@ -0,0 +1,186 @@
+/*
+ * telemetry_decode.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Host-side telemetry decoder
+ */
+
+#include <string.h>
+#include "crc.h"
+#include "telemetry_decode.h"
+
+/*
+ * Resets a decoder for a new stream
+ */
+void tlm_init(tlm_decoder* d) {
+	memset(d, 0, sizeof(*d));
+}
+
+/*
+ * Reads little endian values
+ */
+static uint16_t get16(const uint8_t* p) {
+	return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t* p) {
+	return get16(p) | (uint32_t)get16(p + 2) << 16;
+}
+
+/*
+ * Undoes the COBS encoding of a frame in place
+ *
+ * return: decoded length, or -1 if a code points past the end
+ */
+static long cobs_decode(uint8_t* data, size_t length) {
+	size_t in = 0;
+	size_t out = 0;
+	uint8_t code;
+	uint8_t i;
+
+	while (in < length) {
+		code = data[in++];
+		if (code == 0 || in + code - 1 > length)
+			return -1;
+
+		for (i = 1; i < code; i++)
+			data[out++] = data[in++];
+
+		// A full block of 254 bytes and the end of the frame have no zero after them
+		if (code != 0xFF && in < length)
+			data[out++] = 0;
+	}
+
+	return (long)out;
+}
+
+/*
+ * Fills a message from its payload
+ *
+ * return: 1 if the type is known, 0 otherwise
+ */
+static int read_message(uint8_t type, const uint8_t* p, uint8_t length, tlm_message* m) {
+	m->type = type;
+
+	switch (type) {
+		case TLM_FIX:
+			if (length < TLM_FIX_SIZE)
+				return 0;
+			m->body.fix.stamp = get32(p);
+			m->body.fix.utc_ms = get32(p + 4);
+			m->body.fix.latitude = (int32_t)get32(p + 8) / 1e6;
+			m->body.fix.longitude = (int32_t)get32(p + 12) / 1e6;
+			m->body.fix.altitude = (int16_t)get16(p + 16);
+			m->body.fix.speed = p[18];
+			m->body.fix.valid = p[19];
+			return 1;
+
+		case TLM_NAV:
+			if (length < TLM_NAV_SIZE)
+				return 0;
+			m->body.nav.stamp = get32(p);
+			m->body.nav.waypoint = p[4];
+			m->body.nav.waypoints = p[5];
+			m->body.nav.distance = get16(p + 6);
+			m->body.nav.heading = (int16_t)get16(p + 8);
+			m->body.nav.flags = p[10];
+			return 1;
+
+		case TLM_CUE:
+			if (length < TLM_CUE_SIZE)
+				return 0;
+			m->body.cue.stamp = get32(p);
+			m->body.cue.waypoint = p[4];
+			m->body.cue.turn = p[5];
+			return 1;
+
+		case TLM_STATS:
+			if (length < TLM_STATS_SIZE)
+				return 0;
+			m->body.stats.elapsed_ms = get32(p);
+			m->body.stats.distance = get32(p + 4);
+			m->body.stats.moving_ms = get32(p + 8);
+			m->body.stats.pace = get16(p + 12);
+			m->body.stats.average_pace = get16(p + 14);
+			m->body.stats.elevation_gain = get16(p + 16);
+			m->body.stats.elevation_loss = get16(p + 18);
+			return 1;
+
+		default:
+			return 0;
+	}
+}
+
+/*
+ * Checks a complete frame and hands its messages to the handler. Longer payloads
+ * than known are accepted (fields added at the end by a newer watch).
+ */
+static void decode_frame(tlm_decoder* d, tlm_handler handler, void* arg) {
+	tlm_message m;
+	long length = cobs_decode(d->frame, d->length);
+	const uint8_t* p;
+	const uint8_t* end;
+
+	if (length < 4 || crc16(CRC16_INIT, d->frame, (uint16_t)(length - 2)) !=
+			get16(d->frame + length - 2)) {
+		d->bad_frames++;
+		return;
+	}
+
+	// The messages must end exactly at the CRC
+	end = d->frame + length - 2;
+	for (p = d->frame + 2; p < end; p += 2 + p[1])
+		if (p + 2 > end || p + 2 + p[1] > end) {
+			d->bad_frames++;
+			return;
+		}
+
+	d->frames++;
+	d->dropped += d->frame[1];
+	if (d->have_sequence)
+		d->lost_frames += (uint8_t)(d->frame[0] - d->next_sequence);
+	d->next_sequence = d->frame[0] + 1;
+	d->have_sequence = 1;
+
+	m.sequence = d->frame[0];
+	for (p = d->frame + 2; p < end; p += 2 + p[1]) {
+		if (read_message(p[0], p + 2, p[1], &m))
+			handler(&m, arg);
+		else
+			d->unknown++;
+	}
+}
+
+/*
+ * Feeds received bytes to the decoder. A zero byte ends a frame, bytes before the
+ * first zero of a stream may be the end of a frame joined halfway and are dropped
+ * with it as a bad frame.
+ *
+ * data: received bytes
+ * length: number of bytes
+ * handler: called for each message with arg
+ */
+void tlm_feed(tlm_decoder* d, const void* data, size_t length, tlm_handler handler,
+		void* arg) {
+	const uint8_t* c = data;
+
+	for (; length > 0; length--, c++) {
+		if (*c != 0) {
+			if (d->length == sizeof(d->frame))
+				d->overflow = 1;
+			else
+				d->frame[d->length++] = *c;
+			continue;
+		}
+
+		if (d->overflow)
+			d->bad_frames++;
+		else if (d->length > 0)
+			decode_frame(d, handler, arg);
+
+		d->length = 0;
+		d->overflow = 0;
+	}
+}
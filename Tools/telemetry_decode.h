@@ -0,0 +1,91 @@
+/*
+ * telemetry_decode.h
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Header for the host-side telemetry decoder
+ *
+ * Decodes the frames of the watch's binary telemetry (see telemetry.h for the
+ * format). Bytes are fed in any pieces as they arrive; each good frame is checked
+ * against its CRC and its messages are handed to a callback with their values
+ * converted back to the units of the watch. All state is in a tlm_decoder, so any
+ * number of streams can be decoded at once.
+ */
+
+#ifndef TELEMETRY_DECODE_H_
+#define TELEMETRY_DECODE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "telemetry.h"
+
+typedef struct {
+	uint32_t stamp;			// run clock ms
+	uint32_t utc_ms;		// UTC ms of the day
+	double latitude;		// decimal degrees
+	double longitude;		// decimal degrees
+	int16_t altitude;		// meters
+	uint8_t speed;			// km/h
+	uint8_t valid;
+} tlm_fix;
+
+typedef struct {
+	uint32_t stamp;
+	uint8_t waypoint;		// next waypoint
+	uint8_t waypoints;		// in the route
+	uint16_t distance;		// meters to the next waypoint
+	int16_t heading;		// degrees
+	uint8_t flags;			// TLM_NAV_...
+} tlm_nav;
+
+typedef struct {
+	uint32_t stamp;
+	uint8_t waypoint;		// waypoint the cue is for
+	uint8_t turn;			// direction (navigation.h)
+} tlm_cue;
+
+typedef struct {
+	uint32_t elapsed_ms;
+	uint32_t distance;		// cm
+	uint32_t moving_ms;
+	uint16_t pace;			// s/km over the short window
+	uint16_t average_pace;	// s/km while moving
+	uint16_t elevation_gain;	// meters
+	uint16_t elevation_loss;	// meters
+} tlm_stats;
+
+// One decoded message
+typedef struct {
+	uint8_t type;			// TLM_..., tells which member is filled
+	uint8_t sequence;		// of the frame it came in
+	union {
+		tlm_fix fix;
+		tlm_nav nav;
+		tlm_cue cue;
+		tlm_stats stats;
+	} body;
+} tlm_message;
+
+// Called for every message of every good frame
+typedef void (*tlm_handler)(const tlm_message*, void*);
+
+typedef struct {
+	uint8_t frame[TELEMETRY_ENCODED_SIZE];
+	size_t length;
+	uint8_t overflow;		// frame too long, skipped up to its end
+	uint8_t have_sequence;
+	uint8_t next_sequence;
+	uint32_t frames;		// good frames
+	uint32_t bad_frames;	// bad COBS, CRC or message lengths
+	uint32_t lost_frames;	// missing from the sequence
+	uint32_t dropped;		// messages the watch couldn't fit in a frame
+	uint32_t unknown;		// messages of types skipped
+} tlm_decoder;
+
+// Reset a decoder for a new stream
+void tlm_init(tlm_decoder*);
+// Feed received bytes, calls the handler (with its argument) for each message
+void tlm_feed(tlm_decoder*, const void*, size_t, tlm_handler, void*);
+
+#endif	// TELEMETRY_DECODE_H_
@@ -0,0 +1,99 @@
+/*
+ * telemetry_dump.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Host telemetry dump
+ *
+ * Decodes a capture of the watch's binary telemetry (a file, or the standard input
+ * from a serial port) and prints one CSV line per message:
+ *
+ * 		fix,<seq>,<stamp>,<utc_ms>,<lat>,<lon>,<alt>,<speed>,<valid>
+ * 		nav,<seq>,<stamp>,<waypoint>,<waypoints>,<distance>,<heading>,<flags>
+ * 		cue,<seq>,<stamp>,<waypoint>,<turn>
+ * 		stats,<seq>,<elapsed_ms>,<distance_cm>,<moving_ms>,<pace>,<avg_pace>,<gain>,<loss>
+ *
+ * The frame counts are printed to the standard error at the end.
+ *
+ * Usage:
+ * 		telemetry_dump [capture_file]
+ *
+ * Build:
+ * 		cc -O2 -I"../_Initial Code" -o telemetry_dump telemetry_dump.c telemetry_decode.c
+ * 			"../_Initial Code/crc.c"
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include "telemetry_decode.h"
+
+static const char* turn_names[] = { "straight", "left", "right", "none" };
+
+/*
+ * Prints one message
+ */
+static void print_message(const tlm_message* m, void* arg) {
+	FILE* out = arg;
+
+	switch (m->type) {
+		case TLM_FIX:
+			fprintf(out, "fix,%u,%lu,%lu,%.6f,%.6f,%d,%u,%u\n", m->sequence,
+				(unsigned long)m->body.fix.stamp, (unsigned long)m->body.fix.utc_ms,
+				m->body.fix.latitude, m->body.fix.longitude, m->body.fix.altitude,
+				m->body.fix.speed, m->body.fix.valid);
+			break;
+		case TLM_NAV:
+			fprintf(out, "nav,%u,%lu,%u,%u,%u,%d,0x%02x\n", m->sequence,
+				(unsigned long)m->body.nav.stamp, m->body.nav.waypoint,
+				m->body.nav.waypoints, m->body.nav.distance, m->body.nav.heading,
+				m->body.nav.flags);
+			break;
+		case TLM_CUE:
+			fprintf(out, "cue,%u,%lu,%u,%s\n", m->sequence,
+				(unsigned long)m->body.cue.stamp, m->body.cue.waypoint,
+				(m->body.cue.turn <= NONE) ? turn_names[m->body.cue.turn] : "?");
+			break;
+		case TLM_STATS:
+			fprintf(out, "stats,%u,%lu,%lu,%lu,%u,%u,%u,%u\n", m->sequence,
+				(unsigned long)m->body.stats.elapsed_ms,
+				(unsigned long)m->body.stats.distance,
+				(unsigned long)m->body.stats.moving_ms, m->body.stats.pace,
+				m->body.stats.average_pace, m->body.stats.elevation_gain,
+				m->body.stats.elevation_loss);
+			break;
+	}
+}
+
+int main(int argc, char** argv) {
+	tlm_decoder decoder;
+	unsigned char buffer[4096];
+	FILE* in = stdin;
+	ssize_t n;
+
+	if (argc > 2) {
+		fprintf(stderr, "usage: %s [capture_file]\n", argv[0]);
+		return 1;
+	}
+
+	if (argc == 2 && (in = fopen(argv[1], "rb")) == NULL) {
+		fprintf(stderr, "%s: can't open\n", argv[1]);
+		return 1;
+	}
+
+	tlm_init(&decoder);
+	// read() rather than fread() so a serial port is printed as the frames arrive
+	while ((n = read(fileno(in), buffer, sizeof(buffer))) > 0) {
+		tlm_feed(&decoder, buffer, (size_t)n, print_message, stdout);
+		fflush(stdout);
+	}
+
+	fprintf(stderr, "%lu frames, %lu bad, %lu lost, %lu messages dropped, %lu unknown\n",
+		(unsigned long)decoder.frames, (unsigned long)decoder.bad_frames,
+		(unsigned long)decoder.lost_frames, (unsigned long)decoder.dropped,
+		(unsigned long)decoder.unknown);
+
+	if (in != stdin)
+		fclose(in);
+	return 0;
+}
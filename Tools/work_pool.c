@@ -0,0 +1,183 @@
+/*
+ * work_pool.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Host-side work-stealing thread pool
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "work_pool.h"
+
+// Jobs owned by one thread, [head, tail) still to run
+typedef struct {
+	pthread_mutex_t lock;
+	uint32_t* jobs;
+	uint32_t head;
+	uint32_t tail;
+} pool_deque;
+
+typedef struct {
+	pool_deque* deques;
+	unsigned num_threads;
+	pool_job fn;
+	void* arg;
+} pool_shared;
+
+typedef struct {
+	pool_shared* shared;
+	unsigned id;
+} pool_worker;
+
+/*
+ * Takes a job from the back of the thread's own deque
+ *
+ * return: 1 if a job was taken
+ */
+static int take_own(pool_deque* d, uint32_t* job) {
+	int found = 0;
+
+	pthread_mutex_lock(&d->lock);
+	if (d->tail > d->head) {
+		*job = d->jobs[--d->tail];
+		found = 1;
+	}
+	pthread_mutex_unlock(&d->lock);
+
+	return found;
+}
+
+/*
+ * Steals a job from the front of another thread's deque
+ *
+ * return: 1 if a job was stolen
+ */
+static int steal(pool_deque* d, uint32_t* job) {
+	int found = 0;
+
+	pthread_mutex_lock(&d->lock);
+	if (d->tail > d->head) {
+		*job = d->jobs[d->head++];
+		found = 1;
+	}
+	pthread_mutex_unlock(&d->lock);
+
+	return found;
+}
+
+/*
+ * Thread body: run own jobs, then steal until every deque is empty. No jobs are
+ * added once the pool starts so an empty sweep means the thread is done.
+ */
+static void* worker_main(void* p) {
+	pool_worker* w = p;
+	pool_shared* s = w->shared;
+	uint32_t job;
+
+	for (;;) {
+		unsigned i;
+		int found = take_own(&s->deques[w->id], &job);
+
+		for (i = 1; !found && i < s->num_threads; i++)
+			found = steal(&s->deques[(w->id + i) % s->num_threads], &job);
+
+		if (!found)
+			break;
+
+		s->fn(job, s->arg);
+	}
+
+	return NULL;
+}
+
+/*
+ * Gives the number of online cores
+ */
+unsigned pool_default_threads() {
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (n > 0) ? (unsigned)n : 1;
+}
+
+/*
+ * Runs jobs 0..count-1 across a set of threads and waits for them to finish.
+ * Jobs are dealt round-robin so neighbouring jobs start on different threads.
+ *
+ * num_threads: threads to start (0 = one per core)
+ * count: number of jobs
+ * fn: job function, called once per job number
+ * arg: passed through to fn
+ *
+ * return: 0 on success, -1 if the pool couldn't be set up
+ */
+int pool_run(unsigned num_threads, uint32_t count, pool_job fn, void* arg) {
+	pool_shared shared;
+	pool_worker* workers;
+	pthread_t* threads;
+	char* started;
+	uint32_t job;
+	unsigned i;
+	int result = 0;
+
+	if (num_threads == 0)
+		num_threads = pool_default_threads();
+	if (num_threads > count)
+		num_threads = (count > 0) ? count : 1;
+
+	shared.num_threads = num_threads;
+	shared.fn = fn;
+	shared.arg = arg;
+	shared.deques = calloc(num_threads, sizeof(pool_deque));
+	workers = calloc(num_threads, sizeof(pool_worker));
+	threads = calloc(num_threads, sizeof(pthread_t));
+	started = calloc(num_threads, 1);
+
+	if (shared.deques == NULL || workers == NULL || threads == NULL || started == NULL) {
+		result = -1;
+		goto done;
+	}
+
+	for (i = 0; i < num_threads; i++) {
+		pthread_mutex_init(&shared.deques[i].lock, NULL);
+		shared.deques[i].jobs = malloc((count / num_threads + 1) * sizeof(uint32_t));
+		if (shared.deques[i].jobs == NULL)
+			result = -1;
+	}
+
+	if (result == 0) {
+		// Deal jobs out in reverse so each thread pops its lowest job first
+		for (job = count; job-- > 0;) {
+			pool_deque* d = &shared.deques[job % num_threads];
+			d->jobs[d->tail++] = job;
+		}
+
+		for (i = 0; i < num_threads; i++) {
+			workers[i].shared = &shared;
+			workers[i].id = i;
+		}
+
+		// Thread 0 is the caller, it steals the jobs of any thread that fails to start
+		for (i = 1; i < num_threads; i++)
+			started[i] = (pthread_create(&threads[i], NULL, worker_main, &workers[i]) == 0);
+		worker_main(&workers[0]);
+		for (i = 1; i < num_threads; i++)
+			if (started[i])
+				pthread_join(threads[i], NULL);
+	}
+
+	for (i = 0; i < num_threads; i++) {
+		pthread_mutex_destroy(&shared.deques[i].lock);
+		free(shared.deques[i].jobs);
+	}
+
+done:
+	free(shared.deques);
+	free(workers);
+	free(threads);
+	free(started);
+
+	return result;
+}
@@ -0,0 +1,27 @@
+/*
+ * work_pool.h
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Header for the host-side work-stealing thread pool
+ *
+ * Jobs are numbered 0..n-1 and dealt out to per-thread deques. A thread takes
+ * jobs from the back of its own deque and, once it runs dry, steals from the
+ * front of the others, so long jobs on one thread don't leave the rest idle.
+ */
+
+#ifndef WORK_POOL_H_
+#define WORK_POOL_H_
+
+#include <stdint.h>
+
+// Job function: job number and the caller's argument
+typedef void (*pool_job)(uint32_t, void*);
+
+// Number of threads to use when the caller doesn't say (one per core)
+unsigned pool_default_threads(void);
+// Run jobs 0..count-1 on the given number of threads and wait for them all
+int pool_run(unsigned, uint32_t, pool_job, void*);
+
+#endif	// WORK_POOL_H_
@@ -0,0 +1,101 @@
+/*
+ * auto_pause.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Auto-pause detector
+ */
+
+#include <math.h>
+#include "auto_pause.h"
+
+#define M_PER_DEG_LAT 111195.0		// meters per degree of latitude
+#define DEG_TO_RAD_F 0.017453		// pi/180
+
+/*
+ * Gives the squared distance in meters between two positions
+ */
+static float squared_meters(double lat1, double lon1, double lat2, double lon2) {
+	float y = (float)((lat1 - lat2) * M_PER_DEG_LAT);
+	float x = (float)((lon1 - lon2) * M_PER_DEG_LAT * cos(lat2 * DEG_TO_RAD_F));
+
+	return x * x + y * y;
+}
+
+/*
+ * Starts a new run moving
+ */
+void pause_init(pause_state* p) {
+	p->next = 0;
+	p->count = 0;
+	p->still_fixes = 0;
+	p->paused = 0;
+}
+
+/*
+ * Tells whether the fixes of a full window went nowhere: their net displacement is
+ * no more than their RMS scatter around the mean, plus PAUSE_DISPLACEMENT. The
+ * mean is left in the state's pause position.
+ */
+static uint8_t window_still(pause_state* p) {
+	uint8_t newest = (p->next + PAUSE_WINDOW - 1) % PAUSE_WINDOW;
+	double latitude = 0, longitude = 0;
+	float scatter = 0, displacement;
+	uint8_t i;
+
+	for (i = 0; i < PAUSE_WINDOW; i++) {
+		latitude += p->latitude[i];
+		longitude += p->longitude[i];
+	}
+	latitude /= PAUSE_WINDOW;
+	longitude /= PAUSE_WINDOW;
+
+	for (i = 0; i < PAUSE_WINDOW; i++)
+		scatter += squared_meters(p->latitude[i], p->longitude[i], latitude, longitude);
+	scatter = sqrtf(scatter / PAUSE_WINDOW);
+
+	displacement = sqrtf(squared_meters(p->latitude[newest], p->longitude[newest],
+		p->latitude[p->next], p->longitude[p->next]));
+
+	p->paused_lat = latitude;
+	p->paused_lon = longitude;
+	return displacement <= scatter + PAUSE_DISPLACEMENT;
+}
+
+/*
+ * Adds a valid fix to the window of the last PAUSE_WINDOW fixes
+ *
+ * speed: filtered speed in m/s
+ *
+ * return: 1 if the run is paused after the fix, 0 if moving
+ */
+uint8_t pause_update(pause_state* p, const gps_fix* fix, float speed) {
+	p->latitude[p->next] = fix->latitude;
+	p->longitude[p->next] = fix->longitude;
+	p->next = (p->next + 1) % PAUSE_WINDOW;
+	if (p->count < PAUSE_WINDOW)
+		p->count++;
+
+	if (p->paused) {
+		// The first fix that moves ends the pause
+		if (fix->speed >= PAUSE_RESUME_KPH || squared_meters(fix->latitude,
+				fix->longitude, p->paused_lat, p->paused_lon) >=
+				PAUSE_RESUME_DISTANCE * PAUSE_RESUME_DISTANCE) {
+			p->paused = 0;
+			p->still_fixes = 0;
+		}
+
+		return p->paused;
+	}
+
+	if (speed < PAUSE_SPEED && p->count == PAUSE_WINDOW && window_still(p))
+		p->still_fixes++;
+	else
+		p->still_fixes = 0;
+
+	if (p->still_fixes >= PAUSE_FIXES)
+		p->paused = 1;
+
+	return p->paused;
+}
@@ -0,0 +1,48 @@
+/*
+ * auto_pause.h
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Header for the auto-pause detector
+ *
+ * The run is paused when the filtered speed is low and the last PAUSE_WINDOW fixes
+ * have gone nowhere, for a few fixes in a row. Going nowhere is the net
+ * displacement from the first fix of the window to the last being no more than
+ * the RMS scatter of the window's fixes around their mean (plus a small margin):
+ * GPS jitter at a standstill scatters the fixes without carrying them anywhere,
+ * while a slow walker moves them along a line further than they scatter. The
+ * pause ends on the first fix that moves: the receiver reports a walking speed or
+ * the fix is PAUSE_RESUME_DISTANCE from where the pause started.
+ */
+
+#ifndef AUTO_PAUSE_H_
+#define AUTO_PAUSE_H_
+
+#include <stdint.h>
+#include "gps.h"
+
+#define PAUSE_WINDOW 7				// fixes the displacement is measured over
+#define PAUSE_SPEED 0.8				// m/s filtered speed below which the user may be stopped
+#define PAUSE_DISPLACEMENT 1.0		// meters of displacement over the scatter when stopped
+#define PAUSE_FIXES 3				// stopped fixes in a row before pausing
+#define PAUSE_RESUME_KPH 3			// receiver speed that ends a pause
+#define PAUSE_RESUME_DISTANCE 10.0	// meters from the spot that end a pause
+
+typedef struct {
+	double latitude[PAUSE_WINDOW];	// last fixes, decimal degrees
+	double longitude[PAUSE_WINDOW];
+	uint8_t next;			// where the next fix goes (the oldest once full)
+	uint8_t count;			// fixes in the window
+	uint8_t still_fixes;	// stopped fixes in a row
+	uint8_t paused;
+	double paused_lat;		// mean position of the window when the pause started
+	double paused_lon;
+} pause_state;
+
+// Reset the detector for a new run
+void pause_init(pause_state*);
+// Add a valid fix with the filtered speed (m/s), returns 1 while paused
+uint8_t pause_update(pause_state*, const gps_fix*, float);
+
+#endif	// AUTO_PAUSE_H_
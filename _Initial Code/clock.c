@@ -0,0 +1,94 @@
+/*
+ * clock.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Defines the run clock
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "clock.h"
+
+// Milliseconds since init_clock()
+static volatile uint32_t clock_ms;
+// UTC time of day minus the clock time (modulo one day)
+static uint32_t utc_offset;
+static uint8_t utc_valid;
+
+/*
+ * Timer 1 compare vector, once a millisecond
+ */
+ISR(TIMER1_COMPA_vect) {
+	clock_ms++;
+}
+
+/*
+ * Sets timer 1 to interrupt every millisecond (CTC mode, clock/8)
+ */
+void init_clock() {
+	clock_ms = 0;
+	utc_offset = 0;
+	utc_valid = 0;
+
+	TCCR1A = 0;
+	TCCR1B = (1 << WGM12) | (1 << CS11);
+	OCR1A = (uint16_t)(F_CPU / 8 / 1000 - 1);
+	TIMSK1 = (1 << OCIE1A);
+}
+
+/*
+ * Gives the milliseconds since the clock started. The counter is read with
+ * interrupts off so the four bytes belong together.
+ */
+uint32_t clock_now() {
+	uint8_t sreg = SREG;
+	uint32_t now;
+
+	cli();
+	now = clock_ms;
+	SREG = sreg;
+
+	return now;
+}
+
+/*
+ * Corrects the UTC offset with a time from the GPS. Large errors (first fix, time
+ * jumps) are stepped, small ones slewed so UTC stamps of nearby events stay in order.
+ *
+ * utc_ms: GPS UTC milliseconds of the day
+ * stamp: clock time at which the GPS time was received
+ */
+void clock_discipline(uint32_t utc_ms, uint32_t stamp) {
+	uint32_t offset = (utc_ms + MS_PER_DAY - stamp % MS_PER_DAY) % MS_PER_DAY;
+	int32_t error = (int32_t)(offset - utc_offset);
+
+	// Take the error the short way round the day
+	if (error > (int32_t)(MS_PER_DAY / 2))
+		error -= MS_PER_DAY;
+	else if (error < -(int32_t)(MS_PER_DAY / 2))
+		error += MS_PER_DAY;
+
+	if (!utc_valid || error > CLOCK_STEP_LIMIT || error < -CLOCK_STEP_LIMIT) {
+		utc_offset = offset;
+		utc_valid = 1;
+	} else {
+		utc_offset = (utc_offset + MS_PER_DAY + (error >> CLOCK_SLEW_SHIFT)) % MS_PER_DAY;
+	}
+}
+
+/*
+ * Gives the UTC time of day in milliseconds
+ */
+uint32_t clock_utc() {
+	return (clock_now() % MS_PER_DAY + utc_offset) % MS_PER_DAY;
+}
+
+/*
+ * Tells whether the UTC time has been set from the GPS
+ */
+uint8_t clock_utc_valid() {
+	return utc_valid;
+}
@@ -0,0 +1,34 @@
+/*
+ * clock.h
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Header for the run clock
+ *
+ * A monotonic millisecond clock from timer 1. It never jumps, so it is used to
+ * stamp fixes, cues and records and to time the scheduler. A UTC time of day is
+ * kept alongside it, disciplined to the GPS time (including the fractional
+ * seconds of the NMEA time field).
+ */
+
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+#include <stdint.h>
+
+#define MS_PER_DAY 86400000UL
+#define CLOCK_STEP_LIMIT 1000	// UTC error (ms) above which the offset is stepped
+#define CLOCK_SLEW_SHIFT 3		// smaller errors are corrected by 1/8 per fix
+
+void init_clock(void);
+// Milliseconds since the clock started
+uint32_t clock_now(void);
+// Correct the UTC offset with a GPS time of day (ms) received at a clock time
+void clock_discipline(uint32_t, uint32_t);
+// UTC milliseconds of the day, or the clock time if no GPS time was received yet
+uint32_t clock_utc(void);
+// Tells whether the UTC time has been set from the GPS
+uint8_t clock_utc_valid(void);
+
+#endif	// CLOCK_H_
@@ -0,0 +1,32 @@
+/*
+ * crc.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Defines CRC functions
+ */
+
+#include "crc.h"
+
+/*
+ * Computes the CRC-16/CCITT of a buffer bit by bit (no table, to save flash)
+ *
+ * crc: CRC16_INIT to start, or the result of the previous call to continue
+ * data: bytes to add
+ * length: number of bytes
+ *
+ * return: the updated CRC
+ */
+uint16_t crc16(uint16_t crc, const void* data, uint16_t length) {
+	const uint8_t* p = data;
+	uint8_t i;
+
+	while (length--) {
+		crc ^= (uint16_t)(*p++) << 8;
+		for (i = 0; i < 8; i++)
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+	}
+
+	return crc;
+}
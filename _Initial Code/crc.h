@@ -0,0 +1,20 @@
+/*
+ * crc.h
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Header for CRC functions
+ */
+
+#ifndef CRC_H_
+#define CRC_H_
+
+#include <stdint.h>
+
+#define CRC16_INIT 0xFFFF
+
+// CRC-16/CCITT (polynomial 0x1021) of a buffer, continuing from a previous value
+uint16_t crc16(uint16_t, const void*, uint16_t);
+
+#endif	// CRC_H_
@@ -0,0 +1,266 @@
+/*
+ * display.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Defines display functions
+ *
+ * Each field keeps the text on the screen and the range of characters changed since
+ * they were last sent. Only one changed range is sent per transfer (cursor command
+ * plus characters), one byte per SPI interrupt, so the CPU never waits on the bus.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <string.h>
+
+#include "display.h"
+
+#define MAX_PACKET (DISPLAY_COLS + 3)	// cursor command and one row of characters
+
+// Position and contents of one field
+typedef struct {
+	uint8_t row;
+	uint8_t col;
+	uint8_t width;
+	char text[DISPLAY_COLS];
+	uint8_t dirty_lo;		// first changed character
+	uint8_t dirty_hi;		// one past the last changed character (0 = clean)
+} field;
+
+static field fields[NUM_FIELDS] = {
+	{ 0, 0, 7 },	// FIELD_TIME		"h:mm:ss", "12h34m" from 10 h
+	{ 0, 9, 7 },	// FIELD_DISTANCE	"12.34km", "123.4km" from 100 km
+	{ 1, 0, 7 },	// FIELD_PACE		"5:30/km", "12:30/k" from 10:00/km
+	{ 1, 8, 6 },	// FIELD_STATUS
+	{ 1, 15, 1 },	// FIELD_TURN
+};
+
+// Transfer in progress
+static uint8_t packet[MAX_PACKET];
+static uint8_t packet_length;
+static volatile uint8_t packet_index;
+static volatile uint8_t sending;
+
+static void set_field(uint8_t, const char*);
+
+/*
+ * SPI transfer complete: send the next byte of the packet
+ */
+ISR(SPI_STC_vect) {
+	if (packet_index < packet_length)
+		SPDR = packet[packet_index++];
+	else
+		sending = 0;
+}
+
+/*
+ * Sets up the SPI master (slowest clock, the LCD needs time between bytes) and
+ * clears the screen model so every field is sent once
+ */
+void init_display() {
+	uint8_t i;
+
+	DDRB |= (1 << PB2) | (1 << PB3) | (1 << PB5);	// SS, MOSI, SCK
+	SPCR = (1 << SPIE) | (1 << SPE) | (1 << MSTR) | (1 << SPR1) | (1 << SPR0);
+
+	for (i = 0; i < NUM_FIELDS; i++) {
+		memset(fields[i].text, ' ', fields[i].width);
+		fields[i].dirty_lo = 0;
+		fields[i].dirty_hi = fields[i].width;
+	}
+
+	sending = 0;
+}
+
+/*
+ * Replaces the text of a field and widens its changed range to cover the characters
+ * that differ. The text is padded with spaces or cut to the field width.
+ */
+static void set_field(uint8_t id, const char* text) {
+	field* f = &fields[id];
+	uint8_t i, end = 0;
+
+	for (i = 0; i < f->width; i++) {
+		char c = ' ';
+
+		if (!end && text[i] != 0)
+			c = text[i];
+		else
+			end = 1;
+
+		if (f->text[i] != c) {
+			f->text[i] = c;
+			if (f->dirty_hi == 0 || i < f->dirty_lo)
+				f->dirty_lo = i;
+			if (i + 1 > f->dirty_hi)
+				f->dirty_hi = i + 1;
+		}
+	}
+}
+
+/*
+ * Sends the next changed range if no transfer is in progress
+ */
+void display_task() {
+	uint8_t i;
+
+	if (sending)
+		return;
+
+	for (i = 0; i < NUM_FIELDS; i++) {
+		field* f = &fields[i];
+
+		if (f->dirty_hi == 0)
+			continue;
+
+		packet[0] = LCD_PREFIX;
+		packet[1] = LCD_SET_CURSOR;
+		packet[2] = f->row * LCD_ROW_OFFSET + f->col + f->dirty_lo;
+		packet_length = 3 + f->dirty_hi - f->dirty_lo;
+		memcpy(&packet[3], &f->text[f->dirty_lo], f->dirty_hi - f->dirty_lo);
+		f->dirty_hi = 0;
+
+		// First byte here, the rest from the interrupt
+		sending = 1;
+		packet_index = 1;
+		SPDR = packet[0];
+		return;
+	}
+}
+
+/*
+ * Tells whether any field has changes that haven't been sent
+ */
+uint8_t display_dirty() {
+	uint8_t i;
+
+	for (i = 0; i < NUM_FIELDS; i++)
+		if (fields[i].dirty_hi != 0)
+			return 1;
+
+	return sending;
+}
+
+/*
+ * Writes a number with a fixed count of digits (leading zeros)
+ *
+ * return: pointer past the last digit
+ */
+static char* put_digits(char* p, uint32_t value, uint8_t digits) {
+	uint8_t i;
+
+	for (i = digits; i > 0; i--) {
+		p[i - 1] = '0' + value % 10;
+		value /= 10;
+	}
+
+	return p + digits;
+}
+
+/*
+ * Writes a number without leading zeros
+ *
+ * return: pointer past the last digit
+ */
+static char* put_number(char* p, uint32_t value) {
+	uint8_t digits = 1;
+	uint32_t v;
+
+	for (v = value; v >= 10; v /= 10)
+		digits++;
+
+	return put_digits(p, value, digits);
+}
+
+/*
+ * Shows the elapsed time as h:mm:ss, or as hours and minutes ("12h34m") from 10
+ * hours on so it still fits the field
+ *
+ * ms: elapsed time in milliseconds
+ */
+void display_time(uint32_t ms) {
+	char text[DISPLAY_COLS];
+	uint32_t s = ms / 1000;
+	char* p = put_number(text, s / 3600);
+
+	if (s >= 36000) {
+		*p++ = 'h';
+		p = put_digits(p, (s / 60) % 60, 2);
+		*p++ = 'm';
+	} else {
+		*p++ = ':';
+		p = put_digits(p, (s / 60) % 60, 2);
+		*p++ = ':';
+		p = put_digits(p, s % 60, 2);
+	}
+	*p = 0;
+
+	set_field(FIELD_TIME, text);
+}
+
+/*
+ * Shows the distance in kilometers with two decimals, one from 100 km on and none
+ * from 1000 km on, so it still fits the field
+ *
+ * cm: distance in centimeters
+ */
+void display_distance(uint32_t cm) {
+	char text[DISPLAY_COLS];
+	char* p = put_number(text, cm / 100000);
+
+	if (cm < 10000000) {
+		*p++ = '.';
+		p = put_digits(p, (cm / 1000) % 100, 2);
+	} else if (cm < 100000000) {
+		*p++ = '.';
+		p = put_digits(p, (cm / 10000) % 10, 1);
+	}
+	*p++ = 'k';
+	*p++ = 'm';
+	*p = 0;
+
+	set_field(FIELD_DISTANCE, text);
+}
+
+/*
+ * Shows the pace as m:ss per kilometer ("/k" from 10:00/km on, so it still fits
+ * the field), or dashes when not moving
+ *
+ * pace: seconds per kilometer (0 = not moving)
+ */
+void display_pace(uint16_t pace) {
+	char text[DISPLAY_COLS];
+	char* p;
+
+	if (pace == 0 || pace >= 6000) {
+		set_field(FIELD_PACE, "-:--/km");
+		return;
+	}
+
+	p = put_number(text, pace / 60);
+	*p++ = ':';
+	p = put_digits(p, pace % 60, 2);
+	strcpy(p, (pace < 600) ? "/km" : "/k");
+
+	set_field(FIELD_PACE, text);
+}
+
+/*
+ * Shows a short status message (cut to the field width)
+ */
+void display_status(const char* text) {
+	set_field(FIELD_STATUS, text);
+}
+
+/*
+ * Shows the next turn arrow ('<', '^', '>' or ' ')
+ */
+void display_turn(char arrow) {
+	char text[2];
+
+	text[0] = arrow;
+	text[1] = 0;
+	set_field(FIELD_TURN, text);
+}
@@ -0,0 +1,50 @@
+/*
+ * display.h
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Header for display functions
+ *
+ * The screen is modeled as a set of text fields. Setting a field only marks the
+ * characters that actually changed, and display_task() sends just those
+ * characters to the serial LCD over SPI in the background.
+ */
+
+#ifndef DISPLAY_H_
+#define DISPLAY_H_
+
+#include <stdint.h>
+
+#define DISPLAY_ROWS 2
+#define DISPLAY_COLS 16
+
+// Serial LCD commands (prefix byte, then command)
+#define LCD_PREFIX 0xFE
+#define LCD_SET_CURSOR 0x45
+#define LCD_CLEAR 0x51
+#define LCD_ROW_OFFSET 0x40		// cursor position of the start of the second row
+
+// Fields on the screen
+enum display_field {
+	FIELD_TIME,		// elapsed time, h:mm:ss
+	FIELD_DISTANCE,	// distance, kilometers
+	FIELD_PACE,		// rolling pace, m:ss per km
+	FIELD_STATUS,	// short status text
+	FIELD_TURN,		// next turn arrow
+	NUM_FIELDS
+};
+
+void init_display(void);
+// Send the next changed region if the bus is free (called every scheduler tick)
+void display_task(void);
+// Tells whether changed regions are still waiting to be sent
+uint8_t display_dirty(void);
+
+void display_time(uint32_t);
+void display_distance(uint32_t);
+void display_pace(uint16_t);
+void display_status(const char*);
+void display_turn(char);
+
+#endif	// DISPLAY_H_
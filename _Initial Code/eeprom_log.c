@@ -0,0 +1,209 @@
+/*
+ * eeprom_log.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Defines functions for the EEPROM run history
+ *
+ * An EEPROM byte write takes about 3.3 ms, so writes are done one byte per EEPROM
+ * ready interrupt and never block the caller. Bytes that already hold the value to
+ * be written are skipped, which saves both the time and the wear.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stddef.h>
+
+#include "eeprom_log.h"
+#include "clock.h"
+#include "crc.h"
+
+// Slot of the newest valid record
+static uint8_t newest_slot;
+// Sequence number of the newest valid record
+static uint16_t newest_seq;
+// Whether any valid record exists
+static uint8_t have_record;
+// Record being saved (the write reads from it in the background)
+static ee_record pending;
+
+// Background write: source buffer, destination address, progress
+static const uint8_t* write_src;
+static uint16_t write_addr;
+static uint8_t write_length;
+static volatile uint8_t write_index;
+static volatile uint8_t writing;
+
+/*
+ * Reads one byte from EEPROM (only while no write is in progress)
+ */
+static uint8_t read_byte(uint16_t addr) {
+	EEAR = addr;
+	EECR |= (1 << EERE);
+	return EEDR;
+}
+
+/*
+ * EEPROM ready: write the next byte that differs from what is stored, or stop
+ */
+ISR(EE_READY_vect) {
+	while (write_index < write_length) {
+		uint16_t addr = write_addr + write_index;
+		uint8_t value = write_src[write_index++];
+
+		if (read_byte(addr) != value) {
+			EEAR = addr;
+			EEDR = value;
+			EECR |= (1 << EEMPE);
+			EECR |= (1 << EEPE);
+			return;
+		}
+	}
+
+	EECR &= ~(1 << EERIE);
+	writing = 0;
+}
+
+/*
+ * Reads a buffer from EEPROM
+ *
+ * addr: EEPROM address
+ * data: buffer to fill
+ * length: number of bytes
+ */
+void ee_read(uint16_t addr, void* data, uint8_t length) {
+	uint8_t* p = data;
+
+	while (writing || (EECR & (1 << EEPE)))
+		;	// Wait out a background write (only at boot in practice)
+
+	while (length--)
+		*p++ = read_byte(addr++);
+}
+
+/*
+ * Starts writing a buffer to EEPROM in the background. The buffer must not change
+ * until ee_log_busy() returns 0.
+ *
+ * addr: EEPROM address
+ * data: bytes to write
+ * length: number of bytes
+ *
+ * return: 0 if the write started, 1 if a write is already in progress
+ */
+uint8_t ee_write(uint16_t addr, const void* data, uint8_t length) {
+	if (writing)
+		return 1;
+
+	write_src = data;
+	write_addr = addr;
+	write_length = length;
+	write_index = 0;
+	writing = 1;
+
+	// Interrupt fires as soon as the EEPROM is ready
+	EECR |= (1 << EERIE);
+
+	return 0;
+}
+
+/*
+ * Tells whether a background write is still in progress
+ */
+uint8_t ee_log_busy() {
+	return writing;
+}
+
+/*
+ * Scans the log for the newest record. Only the sequence numbers are read from
+ * every slot, the CRC is checked on the newest and, if it is bad (power lost
+ * while saving), on the next newest and so on.
+ */
+void ee_log_init() {
+	uint16_t seqs[EE_LOG_RECORDS];
+	uint8_t checked[EE_LOG_RECORDS];
+	uint8_t slot, tries;
+
+	have_record = 0;
+	newest_slot = EE_LOG_RECORDS - 1;
+
+	for (slot = 0; slot < EE_LOG_RECORDS; slot++) {
+		ee_read(EE_LOG_START + slot * sizeof(ee_record) + offsetof(ee_record, seq),
+			&seqs[slot], sizeof(uint16_t));
+		checked[slot] = 0;
+	}
+
+	for (tries = 0; tries < EE_LOG_RECORDS; tries++) {
+		uint8_t best = EE_LOG_RECORDS;
+		ee_record record;
+
+		// Newest unchecked slot (sequence numbers compared with wraparound)
+		for (slot = 0; slot < EE_LOG_RECORDS; slot++) {
+			if (checked[slot])
+				continue;
+			if (best == EE_LOG_RECORDS || (int16_t)(seqs[slot] - seqs[best]) > 0)
+				best = slot;
+		}
+
+		checked[best] = 1;
+		ee_read(EE_LOG_START + best * sizeof(ee_record), &record, sizeof(ee_record));
+
+		if (crc16(CRC16_INIT, &record, offsetof(ee_record, crc)) == record.crc) {
+			newest_slot = best;
+			newest_seq = record.seq;
+			have_record = 1;
+			return;
+		}
+	}
+}
+
+/*
+ * Starts saving a run summary to the slot after the newest record
+ *
+ * summary: run summary (copied, may change after the call)
+ *
+ * return: 0 if the save started, 1 if a write is already in progress
+ */
+uint8_t ee_log_save(const run_summary* summary) {
+	uint8_t slot = (newest_slot + 1) % EE_LOG_RECORDS;
+
+	if (writing)
+		return 1;
+
+	pending.summary = *summary;
+	pending.utc_ms = clock_utc();
+	pending.seq = have_record ? newest_seq + 1 : 0;
+	pending.crc = crc16(CRC16_INIT, &pending, offsetof(ee_record, crc));
+
+	ee_write(EE_LOG_START + slot * sizeof(ee_record), &pending, sizeof(ee_record));
+
+	newest_slot = slot;
+	newest_seq = pending.seq;
+	have_record = 1;
+
+	return 0;
+}
+
+/*
+ * Copies the newest saved run summary
+ *
+ * return: 1 if a summary was copied, 0 if the log is empty
+ */
+uint8_t ee_log_latest(run_summary* summary) {
+	ee_record record;
+
+	if (!have_record)
+		return 0;
+
+	// The newest record may still be on its way to EEPROM
+	if (writing) {
+		*summary = pending.summary;
+		return 1;
+	}
+
+	ee_read(EE_LOG_START + newest_slot * sizeof(ee_record), &record, sizeof(ee_record));
+	*summary = record.summary;
+
+	return 1;
+}
@@ -0,0 +1,47 @@
+/*
+ * eeprom_log.h
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Header for the EEPROM run history
+ *
+ * Run summaries are kept in a circular set of EEPROM records, each with a
+ * sequence number and a CRC. Every save goes to the slot after the newest record
+ * so the writes are spread over all the slots.
+ */
+
+#ifndef EEPROM_LOG_H_
+#define EEPROM_LOG_H_
+
+#include <stdint.h>
+#include "run_stats.h"
+
+#define EE_LOG_START 0			// EEPROM address of the first record
+#define EE_LOG_RECORDS 16		// records in the circular log
+
+// One EEPROM record (the CRC is written last)
+typedef struct {
+	run_summary summary;
+	uint32_t utc_ms;		// UTC time of day of the save (run clock)
+	uint16_t seq;			// increases by one with every save
+	uint16_t crc;			// CRC-16 of the fields above
+} ee_record;
+
+#define EE_LOG_END (EE_LOG_START + EE_LOG_RECORDS * sizeof(ee_record))
+#define EE_AIDING_ADDR EE_LOG_END	// last fix saved for GPS aiding (gps_aiding)
+
+// Find the newest record (call once at boot)
+void ee_log_init(void);
+// Start saving a run summary in the background, returns 1 if already saving
+uint8_t ee_log_save(const run_summary*);
+// Copy the newest saved summary, returns 0 if there is none
+uint8_t ee_log_latest(run_summary*);
+// Tells whether a save is still being written
+uint8_t ee_log_busy(void);
+// Start writing a buffer to EEPROM in the background, returns 1 if busy
+uint8_t ee_write(uint16_t, const void*, uint8_t);
+// Read a buffer from EEPROM
+void ee_read(uint16_t, void*, uint8_t);
+
+#endif	// EEPROM_LOG_H_
@@ -0,0 +1,190 @@
+/*
+ * ghost.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Ghost pacer
+ */
+
+#include "ghost.h"
+#include "sd.h"
+
+// What a cursor follows
+#define BY_DISTANCE 0
+#define BY_TIME 1
+
+/*
+ * Gives the value a cursor follows from a record
+ */
+static uint32_t record_key(const track_record* record, uint8_t by) {
+	return (by == BY_DISTANCE) ? record->distance : record->elapsed_ms;
+}
+
+/*
+ * Reads the record after the cursor from the card. The cursor ends at the end of
+ * the file or at a record older than the one before (left over from an earlier,
+ * longer log).
+ */
+static void read_after(ghost_cursor* c, const char* name) {
+	uint32_t offset = (uint32_t)c->next * sizeof(track_record);
+
+	if (sd_read(name, offset, &c->after, sizeof(track_record)) != sizeof(track_record) ||
+			c->after.elapsed_ms < c->before.elapsed_ms)
+		c->end = 1;
+}
+
+/*
+ * Moves a cursor forward until the record after it is past the value, at most
+ * GHOST_MAX_STEPS records. A cursor that falls behind catches up over the next fixes.
+ */
+static void advance(ghost_cursor* c, const char* name, uint8_t by, uint32_t value) {
+	uint8_t steps;
+
+	for (steps = 0; steps < GHOST_MAX_STEPS && !c->end &&
+			record_key(&c->after, by) <= value; steps++) {
+		c->before = c->after;
+		c->next++;
+		read_after(c, name);
+	}
+}
+
+/*
+ * Gives the other value of a cursor (time for BY_DISTANCE, distance for BY_TIME)
+ * at a value of the one it follows, interpolated between its two records. The
+ * ghost stands still at the end of the reference.
+ */
+static uint32_t interpolate(const ghost_cursor* c, uint8_t by, uint32_t value) {
+	uint32_t from = record_key(&c->before, by);
+	uint32_t to = record_key(&c->after, by);
+	uint32_t out_from = record_key(&c->before, !by);
+	uint32_t out_to = record_key(&c->after, !by);
+
+	if (c->end || to <= from || value <= from)
+		return out_from;
+	if (value >= to)
+		return out_to;
+
+	return out_from + (uint32_t)((float)(out_to - out_from) * (value - from) / (to - from));
+}
+
+/*
+ * Starts a cursor at the beginning of the reference
+ *
+ * return: 0 on success, 1 if the reference can't be read
+ */
+static uint8_t start_cursor(ghost_cursor* c, const char* name) {
+	if (sd_read(name, 0, &c->before, sizeof(track_record)) != sizeof(track_record))
+		return 1;
+
+	c->next = 1;
+	c->end = 0;
+	read_after(c, name);
+
+	return 0;
+}
+
+/*
+ * Opens the reference run of a route
+ *
+ * route_name: route file name
+ *
+ * return: 0 on success, 1 if the route has no reference run
+ */
+uint8_t ghost_open(ghost_state* g, const char* route_name) {
+	track_name(route_name, TRACK_EXT, g->name);
+	g->gap_ms = 0;
+	g->gap_cm = 0;
+	g->lead = 0;
+
+	if (start_cursor(&g->by_distance, g->name) != 0)
+		return 1;
+
+	g->by_time = g->by_distance;
+	return 0;
+}
+
+/*
+ * Updates the gaps to the ghost after a fix. The time gap is how much earlier the
+ * runner reached the distance than the ghost, the distance gap how far past the
+ * ghost's position at the same run time the runner is.
+ *
+ * stats: run statistics after the fix
+ *
+ * return: 1 when the runner has passed the ghost or the ghost the runner, 0 otherwise
+ */
+uint8_t ghost_update(ghost_state* g, const run_stats* stats) {
+	int8_t lead = g->lead;
+
+	advance(&g->by_distance, g->name, BY_DISTANCE, stats->distance);
+	advance(&g->by_time, g->name, BY_TIME, stats->elapsed_ms);
+
+	// Past the ghost's finish the time gap stays at the one the runner finished with
+	if (!g->by_distance.end || stats->distance <= g->by_distance.before.distance)
+		g->gap_ms = (int32_t)(interpolate(&g->by_distance, BY_DISTANCE, stats->distance) -
+			stats->elapsed_ms);
+	g->gap_cm = (int32_t)(stats->distance -
+		interpolate(&g->by_time, BY_TIME, stats->elapsed_ms));
+
+	// A margin keeps the lead from flipping while running level with the ghost
+	if (g->gap_ms > GHOST_LEAD_MARGIN)
+		g->lead = 1;
+	else if (g->gap_ms < -GHOST_LEAD_MARGIN)
+		g->lead = -1;
+
+	return lead != 0 && lead != g->lead;
+}
+
+/*
+ * Writes a number without leading zeros
+ *
+ * return: pointer past the last digit
+ */
+static char* put_number(char* p, uint32_t value) {
+	char digits[10];
+	uint8_t n = 0;
+
+	do {
+		digits[n++] = '0' + value % 10;
+		value /= 10;
+	} while (value > 0);
+
+	while (n > 0)
+		*p++ = digits[--n];
+
+	return p;
+}
+
+/*
+ * Writes the gap to the ghost for the status field, "+12s", "-1:05" or "+35m",
+ * switching between the time and distance gaps every GHOST_ALTERNATE_MS
+ *
+ * now: run clock time in ms
+ * text: buffer of at least 7 characters
+ */
+void ghost_text(const ghost_state* g, uint32_t now, char* text) {
+	uint8_t show_time = (now / GHOST_ALTERNATE_MS) % 2 == 0;
+	int32_t gap = show_time ? g->gap_ms / 1000 : g->gap_cm / 100;
+	uint32_t size;
+	char* p = text;
+
+	*p++ = (gap < 0) ? '-' : '+';
+	size = (gap < 0) ? -gap : gap;
+
+	if (!show_time) {
+		p = put_number(p, (size > 9999) ? 9999 : size);
+		*p++ = 'm';
+	} else if (size < 60) {
+		p = put_number(p, size);
+		*p++ = 's';
+	} else {
+		if (size > 99 * 60 + 59)
+			size = 99 * 60 + 59;
+		p = put_number(p, size / 60);
+		*p++ = ':';
+		*p++ = '0' + (size % 60) / 10;
+		*p++ = '0' + size % 10;
+	}
+
+	*p = 0;
+}
@@ -0,0 +1,53 @@
+/*
+ * ghost.h
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Header for the ghost pacer
+ *
+ * Races the runner against the reference run of the route (the track of the last
+ * complete run, see waypt_log.h). The reference is streamed from the card through
+ * two cursors of two records each: one follows the runner's distance, to find
+ * when the ghost was at the same distance, and one follows the run time, to find
+ * where the ghost was at the same time. Both only move forward, a few records per
+ * fix, so a fix costs the same time and RAM however long the reference is.
+ */
+
+#ifndef GHOST_H_
+#define GHOST_H_
+
+#include <stdint.h>
+#include "route_lib.h"
+#include "run_stats.h"
+#include "waypt_log.h"
+
+#define GHOST_MAX_STEPS 4		// reference records a cursor may move per fix
+#define GHOST_LEAD_MARGIN 2000	// ms ahead or behind before the lead changes
+#define GHOST_ALTERNATE_MS 3000	// display time between the time and distance gaps
+
+// Position in the reference run
+typedef struct {
+	track_record before;	// last record at or before the runner
+	track_record after;		// record following it
+	uint16_t next;			// record number of after
+	uint8_t end;			// after is past the end of the reference
+} ghost_cursor;
+
+typedef struct ghost_state {
+	char name[ROUTE_NAME_SIZE];		// reference track file
+	ghost_cursor by_distance;
+	ghost_cursor by_time;
+	int32_t gap_ms;			// time ahead of the ghost (negative when behind)
+	int32_t gap_cm;			// distance ahead of the ghost
+	int8_t lead;			// 1 ahead, -1 behind, 0 not decided yet
+} ghost_state;
+
+// Open the reference run of a route (by route file name), returns 0 on success
+uint8_t ghost_open(ghost_state*, const char*);
+// Update the gaps after a fix, returns 1 when the lead has changed
+uint8_t ghost_update(ghost_state*, const run_stats*);
+// Write the gap for the status field (alternating time and distance)
+void ghost_text(const ghost_state*, uint32_t, char*);
+
+#endif	// GHOST_H_
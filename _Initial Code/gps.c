@@ -11,29 +11,91 @@
  */
 
 #include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 #include "gps.h"
+#include "clock.h"
+#include "crc.h"
+#include "eeprom_log.h"
+#include "uart.h"
 
 // Format received time
 static void set_time(char*);
+#if NMEA_SENTENCES & NMEA_RMC
+// Format received date
+static void set_date(char*);
+#endif
+// Format received latitude or longitude
+static void set_lat_long(char*, uint8_t);
 // Parse collected data
 static void parse_data(char*);
-
-// Holds characters as they arrive from UART
+// Build the command turning on the sentences in NMEA_SENTENCES
+static void make_output_command(void);
+// Ends a command with its checksum and line ending
+static void finish_command(char*, char*);
+// Add a command to the queue for the GPS module
+static void queue_command(const char*);
+// Build and queue the position aiding command
+static void send_aiding(const gps_aiding*);
+// Aid the module once it reports a time that can be trusted
+static void check_aiding(void);
+
+// Holds the wanted fields of the sentences of a fix as they arrive from UART
 static char rx_data[MAX_STRING_SIZE];
-// Copy of rx_data once all characters received
+// Copy of rx_data once all sentences received
 static char rx_data_copy[MAX_STRING_SIZE];
 // Index of array rx_data
 static uint8_t rx_data_pos;
 // Indicates whether or not data is being received
 static volatile uint8_t data_received;
+// Run clock time the first sentence in rx_data started arriving
+static uint32_t rx_stamp;
+// Copy of rx_stamp for rx_data_copy
+static uint32_t rx_stamp_copy;
+// Run clock time of the last '$'
+static uint32_t rx_start;
+// Talker and type of the sentence arriving (up to the first ',')
+static char rx_header[5];
+static uint8_t rx_header_pos;
+// Table index of the sentence arriving, or RX_HEADER / RX_DROP
+static uint8_t rx_sentence;
+// Field of the sentence arriving
+static uint8_t rx_field;
+// Where the sentence arriving starts in rx_data
+static uint8_t rx_sentence_pos;
+// Sentences of the fix received so far (NMEA_GGA etc.)
+static uint8_t rx_seen;
+// XOR of the characters of the sentence arriving, from after '$' up to '*'
+static uint8_t rx_sum;
+// Checksum digits received after '*' (0 before the '*') and their value
+static uint8_t rx_check;
+static uint8_t rx_check_value;
+
+#define RX_HEADER 0xFE		// the header of a sentence is arriving
+#define RX_DROP 0xFF		// the rest of the sentence is not wanted
+
+// A sentence the parser decodes
+typedef struct {
+	char type[3];			// "GGA" etc., after the talker ID
+	uint8_t flag;			// NMEA_GGA etc.
+	uint32_t fields;		// fields decoded (NMEA_FIELD bits)
+	void (*decode)(uint8_t, char*);	// decodes one field
+} nmea_sentence;
 
 // GPSData object to store GPS data
-static typedef struct {
+typedef struct {
 	
-    uint32_t gps_time;      // Current GPS time in seconds
+    uint32_t gps_time;      // Current GPS time in milliseconds of the day
+    uint32_t stamp;         // Run clock time the current data started arriving
     uint8_t hour;           // Local hour time
     uint8_t minute;         // Local minute time
+    uint8_t second;         // UTC second
+    uint8_t day;            // UTC date
+    uint8_t month;
+    uint8_t year;           // Years since 2000
+    uint8_t satellites;     // Satellites used in the fix
+    uint8_t hdop;           // Horizontal dilution of precision in tenths
 
     int8_t speed;           // Speed in MPH (from GPS)
     int16_t heading;        // True course in degrees (from GPS)
@@ -53,137 +115,668 @@ static typedef struct {
 //
 static gps_data my_gps;
 
+// Commands waiting for the UART, sent in order by gps_task()
+static const char* command_queue[COMMAND_QUEUE_SIZE];
+static uint8_t command_head;
+static uint8_t command_count;
+// Buffer for the aiding command (must live until sent)
+static char position_command[MAX_COMMAND_SIZE];
+// Whether the module was given the saved position at startup
+static uint8_t aided;
+// Position saved by the last run, waiting for a time to send it with
+static gps_aiding pending_aiding;
+static uint8_t aiding_pending;
+// Fix being saved for aiding (the EEPROM write reads from it in the background)
+static gps_aiding saved_aiding;
+// Command turning on the sentences decoded
+static char output_command[MAX_COMMAND_SIZE];
+
 
 /*
- *
+ * Starts the GPS: sets the output sentences and rate and, if a valid fix was saved
+ * by the last run, keeps its position to give the module once it reports the time
+ * (see check_aiding()). The commands go out over the UART from gps_task().
  */
 void init_gps() {
 	// Initialize variables
-	// Initialize UART
-	// Send data output commands to GPS module
 	rx_data_pos = 0;
+	rx_sentence = RX_DROP;
+	rx_seen = 0;
 	data_received = NOT_RECEIVED;
+	command_head = 0;
+	command_count = 0;
+	aided = 0;
+	aiding_pending = 0;
+
+	// Send data output commands to GPS module
+	make_output_command();
+	queue_command(output_command);
+	queue_command(UPDATE_1HZ);
+
+	ee_read(EE_AIDING_ADDR, &pending_aiding, sizeof(pending_aiding));
+	if (crc16(CRC16_INIT, &pending_aiding, offsetof(gps_aiding, crc)) == pending_aiding.crc)
+		aiding_pending = 1;
+}
+
+/*
+ * Adds a command to the queue for the GPS module. The string must stay valid until
+ * it has been sent. Commands are dropped if the queue is full.
+ */
+static void queue_command(const char* command) {
+	if (command_count == COMMAND_QUEUE_SIZE)
+		return;
+
+	command_queue[(command_head + command_count) % COMMAND_QUEUE_SIZE] = command;
+	command_count++;
 }
 
 /*
+ * Sends the next queued command once the UART is free
+ */
+void gps_task() {
+	const char* command;
+
+	if (command_count == 0)
+		return;
+
+	command = command_queue[command_head];
+	if (uart_send((char*)command, (uint8_t)strlen(command)) == 0) {
+		command_head = (command_head + 1) % COMMAND_QUEUE_SIZE;
+		command_count--;
+	}
+}
+
+/*
+ * Tells whether commands are waiting to be sent to the GPS module
+ */
+uint8_t gps_commands_waiting() {
+	return command_count > 0;
+}
+
+/*
+ * Writes a number with a fixed count of digits (leading zeros)
  *
+ * return: pointer past the last digit
  */
-void uart_data_rx(char c) {
-	// Store c in the array
-	// When done with sentence, update some variables
-	// Update array index
-	
-	// Only start storing data if first character is '$'
-	if (c != '$' && rx_data_pos == 0)
+static char* put_digits(char* p, uint32_t value, uint8_t digits) {
+	uint8_t i;
+
+	for (i = digits; i > 0; i--) {
+		p[i - 1] = '0' + value % 10;
+		value /= 10;
+	}
+
+	return p + digits;
+}
+
+/*
+ * Writes a number without leading zeros
+ *
+ * return: pointer past the last digit
+ */
+static char* put_number(char* p, uint32_t value) {
+	uint8_t digits = 1;
+	uint32_t v;
+
+	for (v = value; v >= 10; v /= 10)
+		digits++;
+
+	return put_digits(p, value, digits);
+}
+
+/*
+ * Writes a signed decimal degree value with six decimals (no floating point printf)
+ *
+ * return: pointer past the last digit
+ */
+static char* put_degrees(char* p, double degrees) {
+	int32_t micro = (int32_t)(degrees * 1000000.0);
+	uint32_t whole;
+
+	if (micro < 0) {
+		*p++ = '-';
+		micro = -micro;
+	}
+
+	whole = (uint32_t)micro / 1000000;
+	p = put_number(p, whole);
+	*p++ = '.';
+
+	return put_digits(p, (uint32_t)micro % 1000000, 6);
+}
+
+/*
+ * Writes ",YYYY,MM,DD,hh,mm,ss" from a saved fix
+ *
+ * return: pointer past the last digit
+ */
+static char* put_date_time(char* p, const gps_aiding* aiding) {
+	*p++ = ',';
+	p = put_digits(p, 2000 + aiding->year, 4);
+	*p++ = ',';
+	p = put_digits(p, aiding->month, 2);
+	*p++ = ',';
+	p = put_digits(p, aiding->day, 2);
+	*p++ = ',';
+	p = put_digits(p, aiding->time / 3600, 2);
+	*p++ = ',';
+	p = put_digits(p, (aiding->time / 60) % 60, 2);
+	*p++ = ',';
+
+	return put_digits(p, aiding->time % 60, 2);
+}
+
+/*
+ * Ends a command with its checksum (XOR of the characters between '$' and '*')
+ * and line ending
+ */
+static void finish_command(char* command, char* p) {
+	static const char hex[] = "0123456789ABCDEF";
+	uint8_t sum = 0;
+	char* c;
+
+	for (c = command + 1; c < p; c++)
+		sum ^= (uint8_t)*c;
+
+	*p++ = '*';
+	*p++ = hex[sum >> 4];
+	*p++ = hex[sum & 0x0F];
+	*p++ = '\r';
+	*p++ = '\n';
+	*p = 0;
+}
+
+/*
+ * Builds the MTK output command (PMTK314) asking for the sentences in
+ * NMEA_SENTENCES once per fix and no others
+ */
+static void make_output_command() {
+	// Sentences in the order of the command's fields, GSV and the rest are off
+	static const uint8_t order[] = { 0, NMEA_RMC, NMEA_VTG, NMEA_GGA, NMEA_GSA };
+	char* p = output_command + 8;
+	uint8_t i;
+
+	strcpy(output_command, "$PMTK314");
+	for (i = 0; i < 19; i++) {
+		*p++ = ',';
+		*p++ = (i < sizeof(order) && (NMEA_SENTENCES & order[i])) ? '1' : '0';
+	}
+
+	finish_command(output_command, p);
+}
+
+/*
+ * Builds and queues the MTK position aiding command (PMTK741). The command carries
+ * the current UTC time, which must be right: a wrong time makes the module look
+ * for the wrong satellites and start slower than without aiding.
+ *
+ * aiding: saved position, with the current time in place of the fix's
+ */
+static void send_aiding(const gps_aiding* aiding) {
+	char* p;
+
+	strcpy(position_command, "$PMTK741,");
+	p = put_degrees(position_command + 9, aiding->latitude);
+	*p++ = ',';
+	p = put_degrees(p, aiding->longitude);
+	*p++ = ',';
+	if (aiding->altitude < 0) {
+		*p++ = '-';
+		p = put_number(p, (uint32_t)(-aiding->altitude));
+	} else {
+		p = put_number(p, (uint32_t)aiding->altitude);
+	}
+	p = put_date_time(p, aiding);
+	finish_command(position_command, p);
+	queue_command(position_command);
+}
+
+/*
+ * Gives a day count from a date, only for comparing dates a short time apart
+ */
+static uint16_t day_number(uint8_t year, uint8_t month, uint8_t day) {
+	return (uint16_t)year * 372 + month * 31 + day;
+}
+
+/*
+ * Sends the saved position to the module once it reports the time. The watch has
+ * no clock that runs while it is off, so the only trusted time is the module's
+ * own (kept by its backup supply). Its time is trusted once it gives a date from
+ * the day of the saved fix to AIDING_MAX_DAYS after it; a module that lost its
+ * time reports no date or a default one. No aiding is sent once there is a fix.
+ */
+static void check_aiding() {
+	uint16_t saved, today;
+
+	if (!aiding_pending)
 		return;
 
-	if (c == '$') {
-		if (data_received == GGA)
-			data_received = RMC;
-		else
-			data_received = GGA;
+	if (is_fix_valid()) {
+		aiding_pending = 0;
+		return;
+	}
+
+	saved = day_number(pending_aiding.year, pending_aiding.month, pending_aiding.day);
+	today = day_number(my_gps.year, my_gps.month, my_gps.day);
+	if (my_gps.month == 0 || today < saved || today - saved > AIDING_MAX_DAYS)
+		return;
+
+	pending_aiding.time = my_gps.gps_time / 1000;
+	pending_aiding.day = my_gps.day;
+	pending_aiding.month = my_gps.month;
+	pending_aiding.year = my_gps.year;
+	send_aiding(&pending_aiding);
+	aiding_pending = 0;
+	aided = 1;
+}
+
+/*
+ * Saves the last valid fix to EEPROM in the background for aiding the next start.
+ * Called at the end of a run and while the battery is low (main.c).
+ *
+ * return: 0 if the save started, 1 if there is no valid fix or EEPROM is busy
+ */
+uint8_t gps_save_aiding() {
+	if (!is_fix_valid() || ee_log_busy())
+		return 1;
+
+	saved_aiding.latitude = my_gps.latitude;
+	saved_aiding.longitude = my_gps.longitude;
+	saved_aiding.altitude = my_gps.altitude;
+	saved_aiding.time = my_gps.gps_time / 1000;
+	saved_aiding.day = my_gps.day;
+	saved_aiding.month = my_gps.month;
+	saved_aiding.year = my_gps.year;
+	saved_aiding.crc = crc16(CRC16_INIT, &saved_aiding, offsetof(gps_aiding, crc));
+
+	return ee_write(EE_AIDING_ADDR, &saved_aiding, sizeof(saved_aiding));
+}
+
+#if NMEA_SENTENCES & NMEA_GGA
+/*
+ * Decodes a field of a GGA sentence
+ */
+static void decode_gga(uint8_t field, char* p) {
+	switch (field) {
+		case GGA_TIME:
+			set_time(p);
+			break;
+		case GGA_LAT:
+			set_lat_long(p, 0);
+			break;
+		case GGA_NS:
+			if (p[0] == 'S')
+				my_gps.latitude *= -1;
+			break;
+		case GGA_LON:
+			set_lat_long(p, 1);
+			break;
+		case GGA_EW:
+			if (p[0] == 'W')
+				my_gps.longitude *= -1;
+			break;
+		case GGA_QUALITY:
+			if (p[0] != '1')	// Only a plain GPS fix counts
+				my_gps.fix = 0;
+			break;
+		case GGA_SATELLITES:
+			my_gps.satellites = (uint8_t)atoi(p);
+			break;
+		case GGA_HDOP:
+			my_gps.hdop = (uint8_t)(atof(p) * 10);
+			break;
+		case GGA_ALTITUDE:
+			my_gps.altitude = atoi(p);
+			break;
+	}
+}
+#endif
+
+#if NMEA_SENTENCES & NMEA_RMC
+/*
+ * Decodes a field of an RMC sentence
+ */
+static void decode_rmc(uint8_t field, char* p) {
+	switch (field) {
+		case RMC_TIME:
+			set_time(p);
+			break;
+		case RMC_STATUS:
+			if (p[0] != 'A')	// Invalid data
+				my_gps.fix = 0;
+			break;
+		case RMC_LAT:
+			set_lat_long(p, 0);
+			break;
+		case RMC_NS:
+			if (p[0] == 'S')
+				my_gps.latitude *= -1;
+			break;
+		case RMC_LON:
+			set_lat_long(p, 1);
+			break;
+		case RMC_EW:
+			if (p[0] == 'W')
+				my_gps.longitude *= -1;
+			break;
+		case RMC_SPEED:
+			my_gps.speed = (int8_t)(atof(p)*KTS_TO_KPH);
+			break;
+		case RMC_COURSE:
+			my_gps.heading = atoi(p);
+			break;
+		case RMC_DATE:
+			set_date(p);
+			break;
+	}
+}
+#endif
+
+#if NMEA_SENTENCES & NMEA_VTG
+/*
+ * Decodes a field of a VTG sentence
+ */
+static void decode_vtg(uint8_t field, char* p) {
+	switch (field) {
+		case VTG_COURSE:
+			my_gps.heading = atoi(p);
+			break;
+		case VTG_SPEED_KPH:
+			my_gps.speed = (int8_t)atof(p);
+			break;
+	}
+}
+#endif
+
+#if NMEA_SENTENCES & NMEA_GSA
+/*
+ * Decodes a field of a GSA sentence
+ */
+static void decode_gsa(uint8_t field, char* p) {
+	switch (field) {
+		case GSA_FIX_TYPE:
+			if (p[0] != '2' && p[0] != '3')	// No fix
+				my_gps.fix = 0;
+			break;
+		case GSA_HDOP:
+			my_gps.hdop = (uint8_t)(atof(p) * 10);
+			break;
+	}
+}
+#endif
+
+// Sentences decoded, chosen at build time
+static const nmea_sentence sentences[] = {
+#if NMEA_SENTENCES & NMEA_GGA
+	{ "GGA", NMEA_GGA, NMEA_GGA_FIELDS, decode_gga },
+#endif
+#if NMEA_SENTENCES & NMEA_RMC
+	{ "RMC", NMEA_RMC, NMEA_RMC_FIELDS, decode_rmc },
+#endif
+#if NMEA_SENTENCES & NMEA_VTG
+	{ "VTG", NMEA_VTG, NMEA_VTG_FIELDS, decode_vtg },
+#endif
+#if NMEA_SENTENCES & NMEA_GSA
+	{ "GSA", NMEA_GSA, NMEA_GSA_FIELDS, decode_gsa },
+#endif
+};
+
+#define NUM_SENTENCES (sizeof(sentences) / sizeof(sentences[0]))
+
+/*
+ * Starts a sentence once its header has arrived. Sentences are told apart by
+ * their type after the talker ID (GP, GN, ...), so the order the module sends
+ * them in doesn't matter. Sentences not in NMEA_SENTENCES and the module's own
+ * (PMTK) are dropped here. A sentence the fix already has means the next fix has
+ * started, and the incomplete one is thrown away.
+ */
+static void start_sentence() {
+	uint8_t i;
+
+	rx_sentence = RX_DROP;
+	if (rx_header_pos != sizeof(rx_header) || rx_header[0] == 'P')
+		return;
+
+	for (i = 0; i < NUM_SENTENCES; i++) {
+		if (memcmp(rx_header + 2, sentences[i].type, 3) != 0)
+			continue;
+
+		if (rx_seen & sentences[i].flag) {
+			rx_data_pos = 0;
+			rx_seen = 0;
+		}
+
+		// The module starts sending a fix at its time mark, stamp it here
+		if (rx_seen == 0)
+			rx_stamp = rx_start;
+
+		if (rx_data_pos >= MAX_STRING_SIZE - 4)
+			return;	// No room for another sentence
+
+		rx_sentence = i;
+		rx_field = 1;
+		rx_sentence_pos = rx_data_pos;
+		rx_data[rx_data_pos++] = '0' + i;
+		rx_data[rx_data_pos++] = ',';
+		return;
 	}
+}
+
+/*
+ * Ends a sentence once its checksum has been checked. Once every sentence of the
+ * fix has arrived they are handed to update_gps().
+ */
+static void end_sentence() {
+	rx_data[rx_data_pos++] = '\n';
+	rx_seen |= sentences[rx_sentence].flag;
+	rx_sentence = RX_DROP;
 
-	if (c == '\n' && data_received == RMC) {
+	if (rx_seen == NMEA_SENTENCES) {
 		rx_data[rx_data_pos] = 0;
-		rx_data_pos = 0;
-		memcpy(rx_data_copy, rx_data, MAX_STRING_SIZE);
+		memcpy(rx_data_copy, rx_data, rx_data_pos + 1);
+		rx_stamp_copy = rx_stamp;
 		data_received = RECEIVED;
+		rx_data_pos = 0;
+		rx_seen = 0;
+	}
+}
+
+/*
+ * Throws away the fields stored of the sentence arriving
+ */
+static void drop_sentence() {
+	rx_data_pos = rx_sentence_pos;
+	rx_sentence = RX_DROP;
+}
+
+/*
+ * Gives the value of a hexadecimal digit of a checksum
+ *
+ * return: 0 to 15, or -1 if not a digit
+ */
+static int8_t hex_value(char c) {
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return -1;
+}
+
+/*
+ * Takes one character from the GPS module (called from the UART receive
+ * interrupt). Only the fields of the sentence table's masks are stored; the
+ * others are kept as empty fields so the parser can count them. A sentence is
+ * only kept if its "*hh" checksum matches, and one cut off by the next '$' (a
+ * lost '*', after a UART overrun) is thrown away.
+ */
+void uart_data_rx(char c) {
+	int8_t digit;
+
+	if (c == '$') {
+		if (rx_sentence < NUM_SENTENCES)
+			drop_sentence();
+		rx_start = clock_now();
+		rx_sentence = RX_HEADER;
+		rx_header_pos = 0;
+		rx_sum = 0;
+		rx_check = 0;
 		return;
 	}
 
-	rx_data[rx_data_pos++] = c;		
+	if (rx_sentence == RX_DROP)
+		return;
+
+	if (rx_sentence == RX_HEADER) {
+		rx_sum ^= (uint8_t)c;
+		if (c == ',')
+			start_sentence();
+		else if (rx_header_pos < sizeof(rx_header))
+			rx_header[rx_header_pos++] = c;
+		else
+			rx_sentence = RX_DROP;	// Too long for a talker and type
+		return;
+	}
+
+	if (rx_check > 0) {
+		digit = hex_value(c);
+		if (digit < 0) {
+			drop_sentence();
+			return;
+		}
+
+		rx_check_value = (uint8_t)(rx_check_value << 4) | (uint8_t)digit;
+		if (++rx_check == 3) {
+			if (rx_check_value == rx_sum)
+				end_sentence();
+			else
+				drop_sentence();
+		}
+		return;
+	}
+
+	// Room for the sentence ending and the string end
+	if (rx_data_pos >= MAX_STRING_SIZE - 2) {
+		drop_sentence();
+		return;
+	}
+
+	if (c == '*') {
+		rx_check = 1;
+		rx_check_value = 0;
+		return;
+	}
+
+	rx_sum ^= (uint8_t)c;
+	if (c == ',' && rx_field++ < 32)
+		rx_data[rx_data_pos++] = ',';
+	else if (rx_field < 32 && (sentences[rx_sentence].fields & NMEA_FIELD(rx_field)))
+		rx_data[rx_data_pos++] = c;
 }
 
 /*
+ * Tells whether a complete set of sentences is waiting for update_gps()
  *
+ * return: 1 if new data is waiting, 0 otherwise
+ */
+uint8_t gps_data_ready() {
+	return data_received == RECEIVED;
+}
+
+/*
+ * Parses the waiting set of sentences. The run clock's UTC time is corrected
+ * from every valid fix.
+ *
+ * return: 1 if the new data is a valid fix, 0 otherwise
  */
 uint8_t update_gps() {
 	if (data_received == RECEIVED) {
-		char* data = (char*) strtok((char*)rx_data_copy, ",\n");
-		parse_data(data);
+		my_gps.stamp = rx_stamp_copy;
+		parse_data(rx_data_copy);
 		data_received = NOT_RECEIVED;
-		return is_fix_valid();
+		check_aiding();
+
+		if (!is_fix_valid())
+			return 0;
+
+		clock_discipline(my_gps.gps_time, my_gps.stamp);
+		return 1;
 	}
 
 	return 0;
 }
 
 /*
- *
+ * Parses the sentences of a fix: each is its table index, then its fields after
+ * commas, then a newline. Only the fields in the table's masks are decoded.
  */
 static void parse_data(char* data) {
-	char* p = strstr(data, "$GPGGA");
-	if(p != NULL) {
-		p = strchr(p, ',') + 1; // UTC time
-		set_time(p);
-
-		p = strchr(p, ',') + 1; // Latitude
-		set_lat_long(p, 0);
-		p = strchr(p, ',') + 1; // Latitude direction
-		if (p[0] == 'S')
-			my_gps.latitude *= -1;
-
-		p = strchr(p, ',') + 1; // Longitude
-		set_lat_long(p, 1);
-		p = strchr(p, ',') + 1; // Longitude direction
-		if (p[0] == 'W')
-			my_gps.longitude *= -1;
-
-		p = strchr(p, ',') + 1; // Fix quality
-		my_gps.fix = p[0] - 48;
-
-		p = strchr(p, ',') + 1; // Number of satellites
-		p = strchr(p, ',') + 1; // HDOP
-
-		p = strchr(p, ',') + 1; // Altitude
-		my_gps.altitude = atoi(p);
-
-		p = strchr(p, ',') + 1; // Altitude units
-		p = strchr(p, ',') + 1; // Geoidal separation
-		p = strchr(p, ',') + 1; // Geoidal separation units
-		p = strchr(p, ',') + 1; // Age of differental GPS data
-		p = strchr(p, '\n') + 1; // Checksum
-
-		p = strchr(p, ',') + 1; // RMC header
-		p = strchr(p, ',') + 1; // UTC time
-		
-		p = strchr(p, ',') + 1; // Status
-		if (p[0] == 'V')	// Invalid data
-			my_gps.fix = 0;
-
-		p = strchr(p, ',') + 1; // Latitude
-		p = strchr(p, ',') + 1; // Latitude direction
-		p = strchr(p, ',') + 1; // Longitude
-		p = strchr(p, ',') + 1; // Longitude direction
-
-		p = strchr(p, ',') + 1; // Speed
-		my_gps.speed = (int8_t)(atof(p)*KTS_TO_KPH);
-
-		p = strchr(p, ',') + 1; // Heading
-		my_gps.heading = atoi(p);
-
-		p = strchr(p, ',') + 1; // Date
-
-		// The magnetic variation and checksum are not used
+	char* p = data;
+
+	// Cleared by any sentence reporting no fix
+	my_gps.fix = 1;
+
+	while (*p != 0) {
+		const nmea_sentence* sentence = &sentences[*p - '0'];
+		uint8_t field = 1;
+
+		for (p++; *p == ','; field++) {
+			p++;
+			if (sentence->fields & NMEA_FIELD(field))
+				sentence->decode(field, p);
+			p += strcspn(p, ",\n");
+		}
+
+		p++;	// Newline
 	}
 }
 
 /*
- * Change received GPS time to integer seconds. The GPS time is given in 
- * hhmmss.ss format and is in UTC time standard. Discards fractional seconds
+ * Change received GPS time to milliseconds of the day. The GPS time is given in
+ * hhmmss.sss format (one to three decimals, or none) and is in UTC time standard.
  * 
  * data: array of integers giving current UTC time
  */
 static void set_time(char* data) {
 	uint32_t time = (uint32_t)((data[0]-48)*10+(data[1]-48))*3600;	// Hours
+	uint16_t scale = 100;
+	uint8_t i;
+
 	time += (uint32_t)((data[2]-48)*10+(data[3]-48))*60;	// Minutes
 	time += (uint32_t)((data[4]-48)*10+(data[5]-48));		// Seconds
+	time *= 1000;
+
+	// Fractional seconds
+	if (data[6] == '.') {
+		for (i = 7; i < 10 && data[i] >= '0' && data[i] <= '9'; i++) {
+			time += (uint32_t)(data[i]-48) * scale;
+			scale /= 10;
+		}
+	}
+
 	my_gps.gps_time = time;
 	my_gps.hour = (uint8_t)((data[0]-48)*10+(data[1]-48));
 	my_gps.minute = (uint8_t)((data[2]-48)*10+(data[3]-48));
+	my_gps.second = (uint8_t)((data[4]-48)*10+(data[5]-48));
 }
 
+#if NMEA_SENTENCES & NMEA_RMC
+/*
+ * Stores the received GPS date. The date is given in ddmmyy format.
+ *
+ * data: array of characters giving the current UTC date
+ */
+static void set_date(char* data) {
+	if (data[0] == ',')
+		return;	// Empty field before the first fix
+
+	my_gps.day = (uint8_t)((data[0]-48)*10+(data[1]-48));
+	my_gps.month = (uint8_t)((data[2]-48)*10+(data[3]-48));
+	my_gps.year = (uint8_t)((data[4]-48)*10+(data[5]-48));
+}
+#endif
+
 /*
  * Converts a receiver latitude or longitude position stored in a uint8_t
  * array to a double. Received latitude or longitude is given in ddmm.mmm
@@ -212,13 +805,6 @@ static void set_lat_long(char* data, uint8_t dim) {
 	}
 }
 
-/*
- *
- */
-uint32_t get_elapsed_time() {
-	return my_gps.elapsed_time;
-}
-
 /*
  *
  */
@@ -241,6 +827,28 @@ char* get_date() {
 	return NULL;
 }
 
+/*
+ * Gives the number of satellites used in the last fix
+ */
+uint8_t get_satellites() {
+	return my_gps.satellites;
+}
+
+/*
+ * Gives the horizontal dilution of precision of the last fix in tenths (0 if not
+ * decoded)
+ */
+uint8_t get_hdop() {
+	return my_gps.hdop;
+}
+
+/*
+ * Tells whether the module was given a saved position and time at startup
+ */
+uint8_t gps_aided() {
+	return aided;
+}
+
 /*
  *
  */
@@ -276,6 +884,22 @@ int16_t get_altitude(){
 	return my_gps.altitude;
 }
 
+/*
+ * Copies the latest parsed GPS data into a fix structure
+ *
+ * fix: structure to fill
+ */
+void get_fix(gps_fix* fix) {
+	fix->latitude = my_gps.latitude;
+	fix->longitude = my_gps.longitude;
+	fix->altitude = my_gps.altitude;
+	fix->speed = my_gps.speed;
+	fix->heading = my_gps.heading;
+	fix->utc_ms = my_gps.gps_time;
+	fix->stamp = my_gps.stamp;
+	fix->valid = is_fix_valid();
+}
+
 /*
  * Tells whether or not the latest GPS is valid
  *
@@ -15,26 +15,124 @@
 #ifndef GPS_H_
 #define GPS_H_
 
+#include <stdint.h>
+
 // Defines the max number of data character in a GPS sentence that can be 
 // stored in the receive buffer
 #define MAX_STRING_SIZE 200
-// Command to turn on RMC and GGA output from GPS module
-#define GGA_RMC_OUTPUT "$PMTK314,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0*28\r\n";
 // 1Hz update rate
-#define UPDATE_1HZ "$PMTK220,1000*1F\r\n";
+#define UPDATE_1HZ "$PMTK220,1000*1F\r\n"
+// Longest command built for the GPS module (position aiding)
+#define MAX_COMMAND_SIZE 80
+// Days after the saved fix the module's date is believed for aiding
+#define AIDING_MAX_DAYS 31
+// Commands waiting to be sent to the GPS module
+#define COMMAND_QUEUE_SIZE 4
 // Conversion knots to miles per hour
 #define KTS_TO_MPH 1.151
 // Conversion knots to kilometers per hour
 #define KTS_TO_KPH 1.852
 
+// NMEA sentences the parser can decode
+#define NMEA_GGA 0x01		// time, position, fix quality, satellites, altitude
+#define NMEA_RMC 0x02		// time, status, position, speed, course, date
+#define NMEA_VTG 0x04		// course, speed
+#define NMEA_GSA 0x08		// fix type, dilution of precision
+
+// Sentences the watch asks the module for and decodes (set with -DNMEA_SENTENCES)
+#ifndef NMEA_SENTENCES
+#define NMEA_SENTENCES (NMEA_GGA | NMEA_RMC)
+#endif
+
+#if !(NMEA_SENTENCES & (NMEA_GGA | NMEA_RMC))
+#error "NMEA_SENTENCES needs GGA or RMC for the position"
+#endif
+
+// Bit of a field in a field mask (fields are numbered from 1 after the header)
+#define NMEA_FIELD(n) (1UL << (n))
+
+// Fields of each sentence
+enum nmea_field {
+	GGA_TIME = 1, GGA_LAT, GGA_NS, GGA_LON, GGA_EW, GGA_QUALITY, GGA_SATELLITES,
+		GGA_HDOP, GGA_ALTITUDE,
+	RMC_TIME = 1, RMC_STATUS, RMC_LAT, RMC_NS, RMC_LON, RMC_EW, RMC_SPEED, RMC_COURSE,
+		RMC_DATE,
+	VTG_COURSE = 1, VTG_SPEED_KPH = 7,
+	GSA_FIX_TYPE = 2, GSA_HDOP = 16
+};
+
+#define NMEA_POSITION(s) (NMEA_FIELD(s##_LAT) | NMEA_FIELD(s##_NS) | NMEA_FIELD(s##_LON) | \
+	NMEA_FIELD(s##_EW))
+
+// Fields decoded from each sentence (set with -DNMEA_GGA_FIELDS=... and so on). By
+// default time and position come from GGA, speed and course from VTG, when they
+// are decoded, and from RMC otherwise.
+#ifndef NMEA_GGA_FIELDS
+#define NMEA_GGA_FIELDS (NMEA_FIELD(GGA_TIME) | NMEA_POSITION(GGA) | \
+	NMEA_FIELD(GGA_QUALITY) | NMEA_FIELD(GGA_SATELLITES) | NMEA_FIELD(GGA_ALTITUDE))
+#endif
+
+#ifndef NMEA_RMC_FIELDS
+#if NMEA_SENTENCES & NMEA_GGA
+#define NMEA_RMC_TIME_POSITION 0
+#else
+#define NMEA_RMC_TIME_POSITION (NMEA_FIELD(RMC_TIME) | NMEA_POSITION(RMC))
+#endif
+#if NMEA_SENTENCES & NMEA_VTG
+#define NMEA_RMC_MOTION 0
+#else
+#define NMEA_RMC_MOTION (NMEA_FIELD(RMC_SPEED) | NMEA_FIELD(RMC_COURSE))
+#endif
+#define NMEA_RMC_FIELDS (NMEA_FIELD(RMC_STATUS) | NMEA_FIELD(RMC_DATE) | \
+	NMEA_RMC_TIME_POSITION | NMEA_RMC_MOTION)
+#endif
+
+#ifndef NMEA_VTG_FIELDS
+#define NMEA_VTG_FIELDS (NMEA_FIELD(VTG_COURSE) | NMEA_FIELD(VTG_SPEED_KPH))
+#endif
+
+#ifndef NMEA_GSA_FIELDS
+#define NMEA_GSA_FIELDS (NMEA_FIELD(GSA_FIX_TYPE) | NMEA_FIELD(GSA_HDOP))
+#endif
+
 // The different states of data collection
 enum data_rx_state {
 	RECEIVED,
-	NOT_RECEIVED,
-	GGA,
-	RMC
+	NOT_RECEIVED
 };
 
+// One GPS fix as used by the navigation code
+typedef struct {
+	double latitude;		// decimal degrees
+	double longitude;		// decimal degrees
+	int16_t altitude;		// meters
+	int8_t speed;			// kilometers per hour
+	int16_t heading;		// true course in degrees
+	uint32_t utc_ms;		// UTC milliseconds of the day
+	uint32_t stamp;			// run clock time the fix started arriving
+	uint8_t valid;			// 1 if the receiver reports a valid fix
+} gps_fix;
+
+// Tells whether a new set of sentences is waiting to be parsed
+uint8_t gps_data_ready(void);
+// Last valid position and time, kept in EEPROM to aid the next start
+typedef struct {
+	double latitude;		// decimal degrees
+	double longitude;		// decimal degrees
+	int16_t altitude;		// meters
+	uint32_t time;			// UTC seconds of the day of the fix
+	uint8_t day;
+	uint8_t month;
+	uint8_t year;			// years since 2000
+	uint16_t crc;			// CRC-16 of the fields above
+} gps_aiding;
+
+// Send the next queued command to the GPS module (called every scheduler tick)
+void gps_task(void);
+// Tells whether commands are waiting for the UART (other senders wait for them)
+uint8_t gps_commands_waiting(void);
+// Save the last valid fix for aiding, returns 1 if there is none or EEPROM is busy
+uint8_t gps_save_aiding(void);
 // Move parsed data into a "non-volatile" data structure (add lock)
 uint8_t update_gps(void);
 // Initialization sequence
@@ -43,10 +141,12 @@ void init_gps(void);
 void uart_data_rx(char);
 
 //************* Retrieval functions ***********************
-uint32_t get_elapsed_time(void);
 uint8_t get_hour(void);
 uint8_t get_minute(void);
 char* get_date(void);
+uint8_t get_satellites(void);
+uint8_t get_hdop(void);
+uint8_t gps_aided(void);
 
 int8_t get_speed(void);
 int16_t get_heading(void);
@@ -56,5 +156,6 @@ double get_longitude(void);
 int16_t get_altitude(void);
 
 uint8_t is_fix_valid(void);
+void get_fix(gps_fix*);
 
 #endif // GPS_H_
\ No newline at end of file
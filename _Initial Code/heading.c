@@ -0,0 +1,107 @@
+/*
+ * heading.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Low-speed heading estimator
+ *
+ * Every fix costs at most one pass over the ring (HEADING_RING positions), so the
+ * time per fix is fixed.
+ */
+
+#include <math.h>
+#include "heading.h"
+
+#define M_PER_UDEG_LAT 0.111195		// meters per microdegree of latitude
+#define DEG_TO_RAD_F 0.017453		// pi/180
+#define RAD_TO_DEG_F 57.29578		// 180/pi
+
+/*
+ * Empties the ring, the next fix starts a new track
+ */
+void heading_init(heading_state* h) {
+	h->head = HEADING_RING - 1;
+	h->count = 0;
+	h->lon_scale = 0;
+	h->heading = 0;
+	h->valid = 0;
+}
+
+/*
+ * Gives the heading from the displacement between the newest position and the
+ * newest older one at least HEADING_MIN_BASELINE away
+ *
+ * return: 1 if a heading was found, 0 if no recent position is far enough away
+ */
+static uint8_t displacement_heading(const heading_state* h, int16_t* heading) {
+	const heading_point* newest = &h->ring[h->head];
+	uint8_t i;
+
+	for (i = 1; i < h->count; i++) {
+		const heading_point* p = &h->ring[(h->head - i) & (HEADING_RING - 1)];
+		float north, east;
+
+		// Older positions are older still, a heading from them would lag a turn
+		if (newest->stamp - p->stamp > HEADING_MAX_AGE)
+			return 0;
+
+		north = (newest->lat - p->lat) * M_PER_UDEG_LAT;
+		east = (newest->lon - p->lon) * h->lon_scale;
+
+		if (north * north + east * east >= HEADING_MIN_BASELINE * HEADING_MIN_BASELINE) {
+			int16_t degrees = (int16_t)(atan2f(east, north) * RAD_TO_DEG_F);
+			*heading = (degrees < 0) ? degrees + 360 : degrees;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Adds a fix to the ring and gives the best heading for it. The receiver's course
+ * is used when it is moving fast enough for it to be good, otherwise the
+ * displacement heading. When neither is available the last heading is kept, so
+ * standing still doesn't swing the heading (and cue a turn) on position noise.
+ *
+ * fix: the new GPS fix, ignored if not valid
+ *
+ * return: heading in degrees (0-359)
+ */
+int16_t heading_update(heading_state* h, const gps_fix* fix) {
+	heading_point* p;
+	int16_t heading;
+
+	if (!fix->valid)
+		return h->heading;
+
+	if (h->count == 0)
+		h->lon_scale = M_PER_UDEG_LAT * cosf(fix->latitude * DEG_TO_RAD_F);
+
+	h->head = (h->head + 1) & (HEADING_RING - 1);
+	if (h->count < HEADING_RING)
+		h->count++;
+
+	p = &h->ring[h->head];
+	p->lat = (int32_t)lround(fix->latitude * 1000000.0);
+	p->lon = (int32_t)lround(fix->longitude * 1000000.0);
+	p->stamp = fix->stamp;
+
+	if (fix->speed >= HEADING_COURSE_SPEED) {
+		h->heading = fix->heading;
+		h->valid = 1;
+	} else if (displacement_heading(h, &heading)) {
+		h->heading = heading;
+		h->valid = 1;
+	}
+
+	return h->heading;
+}
+
+/*
+ * Tells whether a heading has been found since the ring was emptied
+ */
+uint8_t heading_valid(const heading_state* h) {
+	return h->valid;
+}
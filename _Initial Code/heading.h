@@ -0,0 +1,50 @@
+/*
+ * heading.h
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Header for the low-speed heading estimator
+ *
+ * The receiver's course is only good above about 4 MPH. Below that the heading is
+ * taken from the displacement between the newest fix and an older one in a small
+ * ring of recent positions. The older fix is the newest one far enough away to
+ * swamp the position noise, so the baseline is short when moving and grows when
+ * slow. Positions are kept in fixed point (microdegrees).
+ */
+
+#ifndef HEADING_H_
+#define HEADING_H_
+
+#include <stdint.h>
+#include "gps.h"
+
+#define HEADING_RING 16				// recent fixes kept (power of 2)
+#define HEADING_COURSE_SPEED 7		// km/h above which the receiver's course is used
+#define HEADING_MIN_BASELINE 6.0	// meters of displacement for an estimate
+#define HEADING_MAX_AGE 15000		// oldest fix used for an estimate (ms)
+
+// One recent position
+typedef struct {
+	int32_t lat;		// microdegrees
+	int32_t lon;		// microdegrees
+	uint32_t stamp;		// run clock time of the fix
+} heading_point;
+
+typedef struct {
+	heading_point ring[HEADING_RING];
+	uint8_t head;			// index of the newest position
+	uint8_t count;			// positions in the ring
+	float lon_scale;		// meters per microdegree of longitude
+	int16_t heading;		// last heading given, degrees
+	uint8_t valid;			// heading holds an estimate or a reliable course
+} heading_state;
+
+// Empty the ring
+void heading_init(heading_state*);
+// Add a fix and give the best heading in degrees (the last one if there is none)
+int16_t heading_update(heading_state*, const gps_fix*);
+// Tells whether a heading has been found since the ring was emptied
+uint8_t heading_valid(const heading_state*);
+
+#endif	// HEADING_H_
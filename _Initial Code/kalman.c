@@ -0,0 +1,142 @@
+/*
+ * kalman.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Position filter
+ *
+ * Each axis is a two state (position, velocity) filter driven by white noise
+ * acceleration. Fixes that land far outside the expected position (multipath)
+ * are not thrown away but weighted down in proportion to how far out they are.
+ */
+
+#include <math.h>
+#include "kalman.h"
+
+#define M_PER_DEG_LAT 111195.0	// meters per degree of latitude
+#define DEG_TO_RAD_F 0.017453	// pi/180
+
+/*
+ * Advances one axis by dt seconds
+ */
+static void axis_predict(kf_axis* a, float dt) {
+	float q = KF_ACCEL_VAR;
+	float dt2 = dt * dt;
+
+	a->pos += a->vel * dt;
+
+	// P = F P F' + Q for F = [1 dt; 0 1]
+	a->p00 += dt * (2 * a->p01 + dt * a->p11) + q * dt2 * dt2 / 4;
+	a->p01 += dt * a->p11 + q * dt2 * dt / 2;
+	a->p11 += q * dt2;
+}
+
+/*
+ * Corrects one axis with a position measurement
+ */
+static void axis_correct(kf_axis* a, float meas) {
+	float r = KF_MEAS_VAR;
+	float innov = meas - a->pos;
+	float s = a->p00 + r;
+	float k0, k1;
+
+	// Damp outliers: grow the measurement variance until the fix sits on the gate
+	if (innov * innov > KF_GATE * s) {
+		r = innov * innov / KF_GATE - a->p00;
+		s = a->p00 + r;
+	}
+
+	k0 = a->p00 / s;
+	k1 = a->p01 / s;
+
+	a->pos += k0 * innov;
+	a->vel += k1 * innov;
+
+	// P = (I - K H) P
+	a->p11 -= k1 * a->p01;
+	a->p01 -= k0 * a->p01;
+	a->p00 -= k0 * a->p00;
+}
+
+/*
+ * Starts an axis at a position with unknown velocity
+ */
+static void axis_start(kf_axis* a, float pos) {
+	a->pos = pos;
+	a->vel = 0;
+	a->p00 = KF_MEAS_VAR;
+	a->p01 = 0;
+	a->p11 = 25.0;	// (5 m/s)^2, faster than most runners
+}
+
+/*
+ * Resets the filter
+ */
+void kalman_init(kalman_state* k) {
+	k->initialized = 0;
+}
+
+/*
+ * Advances the filter to the time of a fix and corrects it with the fix. The
+ * first fix after kalman_init() becomes the origin of the local frame.
+ *
+ * k: filter
+ * fix: valid GPS fix
+ * dt: seconds since the previous fix
+ */
+void kalman_update(kalman_state* k, const gps_fix* fix, float dt) {
+	float east, north;
+
+	if (!k->initialized) {
+		k->origin_lat = fix->latitude;
+		k->origin_lon = fix->longitude;
+		k->m_per_deg_lon = (float)(M_PER_DEG_LAT * cos(fix->latitude * DEG_TO_RAD_F));
+		axis_start(&k->east, 0);
+		axis_start(&k->north, 0);
+		k->initialized = 1;
+		return;
+	}
+
+	east = (float)(fix->longitude - k->origin_lon) * k->m_per_deg_lon;
+	north = (float)((fix->latitude - k->origin_lat) * M_PER_DEG_LAT);
+
+	axis_predict(&k->east, dt);
+	axis_predict(&k->north, dt);
+	axis_correct(&k->east, east);
+	axis_correct(&k->north, north);
+}
+
+/*
+ * Gives the filtered position, optionally predicted forward in time
+ *
+ * k: filter
+ * ms: milliseconds after the last fix to predict (capped at KF_MAX_PREDICT)
+ * lat, lon: filled with the position in decimal degrees
+ */
+void kalman_position(const kalman_state* k, uint16_t ms, double* lat, double* lon) {
+	float dt;
+
+	if (ms > KF_MAX_PREDICT)
+		ms = KF_MAX_PREDICT;
+	dt = ms / 1000.0f;
+
+	*lat = k->origin_lat + (k->north.pos + k->north.vel * dt) / M_PER_DEG_LAT;
+	*lon = k->origin_lon + (k->east.pos + k->east.vel * dt) / k->m_per_deg_lon;
+}
+
+/*
+ * Gives the filtered ground speed in meters per second
+ */
+float kalman_speed(const kalman_state* k) {
+	return sqrtf(k->east.vel * k->east.vel + k->north.vel * k->north.vel);
+}
+
+/*
+ * Gives the filtered course over ground in degrees (0-359)
+ */
+int16_t kalman_heading(const kalman_state* k) {
+	int16_t heading = (int16_t)(atan2f(k->east.vel, k->north.vel) * 57.29578f);
+
+	return (heading < 0) ? heading + 360 : heading;
+}
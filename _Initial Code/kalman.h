@@ -0,0 +1,54 @@
+/*
+ * kalman.h
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Header for the position filter
+ *
+ * A constant-velocity Kalman filter run separately on the east and north axes of
+ * a local flat-earth frame centered on the first fix. It smooths the GPS
+ * position, estimates speed and heading, and predicts the position between fixes.
+ */
+
+#ifndef KALMAN_H_
+#define KALMAN_H_
+
+#include <stdint.h>
+#include "gps.h"
+
+#define KF_MEAS_VAR 25.0		// GPS position variance (m^2), about 5 m
+#define KF_ACCEL_VAR 1.0		// runner acceleration variance (m^2/s^4)
+#define KF_GATE 9.0			// squared innovation (in variances) before a fix is damped
+#define KF_MAX_PREDICT 2000	// longest prediction between fixes (ms)
+
+// State and covariance for one axis (position, velocity)
+typedef struct {
+	float pos;		// meters from the origin
+	float vel;		// meters per second
+	float p00;		// position variance
+	float p01;		// position/velocity covariance
+	float p11;		// velocity variance
+} kf_axis;
+
+typedef struct {
+	double origin_lat;		// decimal degrees
+	double origin_lon;		// decimal degrees
+	float m_per_deg_lon;	// meters per degree of longitude at the origin
+	kf_axis east;
+	kf_axis north;
+	uint8_t initialized;
+} kalman_state;
+
+// Reset the filter, the next fix becomes the origin
+void kalman_init(kalman_state*);
+// Advance the filter to the next fix and correct it with the fix
+void kalman_update(kalman_state*, const gps_fix*, float);
+// Position of the last update, or predicted a number of ms after it
+void kalman_position(const kalman_state*, uint16_t, double*, double*);
+// Filtered speed in meters per second
+float kalman_speed(const kalman_state*);
+// Filtered heading in degrees (0-359)
+int16_t kalman_heading(const kalman_state*);
+
+#endif	// KALMAN_H_
@@ -5,15 +5,182 @@
  * Author: Joel Heck
  *
  * Main program
+ *
+ * The run clock (timer 1) paces a simple task scheduler. Navigation runs every tick
+ * so turn cues can fire between GPS fixes. The CPU idles between ticks, and the
+ * ticks are further apart while the run is auto-paused.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+#include "clock.h"
+#include "display.h"
+#include "eeprom_log.h"
+#include "ghost.h"
+#include "navigation.h"
+#include "power.h"
+#include "route_lib.h"
+#include "route_table.h"
+#include "sd.h"
+#include "telemetry.h"
+#include "uart.h"
+#include "waypt_log.h"
+
+#define TICK_MS 100		// scheduler tick (10 Hz)
+#define PAUSED_TICK_MS 500	// scheduler tick while auto-paused (2 Hz)
+#define NO_ROUTE 0xFFFF		// not a route library record number
+
+// Reference run of the selected route
+static ghost_state ghost;
+
+/*
+ * Starts the track log of the route and races its last complete run if any
+ *
+ * name: route file name
  */
+static void start_route(nav_state* nav, const char* name) {
+	waypt_log_start(name);
+	if (ghost_open(&ghost, name) == 0)
+		nav->ghost = &ghost;
+
+	display_status("");
+}
+
+#ifdef HAVE_COURSE
+// Course compiled into flash (Tools/route_compile.c)
+extern const route_table course PROGMEM;
+
+/*
+ * Starts the navigation on the course compiled into the watch once the first fix
+ * is near any of its legs
+ *
+ * return: 1 once the course is started, 0 if it is not nearby (try again later)
+ */
+static uint8_t select_route(nav_state* nav) {
+	char name[ROUTE_NAME_SIZE];
+	gps_fix fix;
+
+	get_fix(&fix);
+	if (route_table_near(&course, fix.latitude, fix.longitude) == ROUTE_TABLE_NONE) {
+		display_status("NO RTE");
+		return 0;
+	}
+
+	if (!init_nav_table(nav, &course)) {
+		display_status("BADRTE");
+		return 0;
+	}
+
+	route_table_name(&course, name);
+	start_route(nav, name);
+	return 1;
+}
+#else
+// Waypoints of the selected route
+static waypoint route[ROUTE_MAX_WAYPTS];
+// Record number of a route that failed to load, not read again
+static uint16_t bad_route = NO_ROUTE;
 
 /*
- * Timer A0 compare vector for task update rate
+ * Picks the route starting nearest the first fix from the route library and
+ * starts the navigation on it. A route that fails to load is not read from the
+ * card again on the next ticks.
+ *
+ * return: 1 once a route is loaded, 0 if no route starts nearby (try again later)
  */
-ISR(TIMER0_COMPA_vect) {
-	if ()
+static uint8_t select_route(nav_state* nav) {
+	route_candidate nearest;
+	route_lib_record record;
+	gps_fix fix;
+	uint8_t count;
+
+	get_fix(&fix);
+	if (route_lib_nearby(fix.latitude, fix.longitude, &nearest, 1) == 0) {
+		display_status("NO RTE");
+		return 0;
+	}
+
+	if (nearest.route == bad_route)
+		return 0;
+
+	count = route_lib_load(nearest.route, route, ROUTE_MAX_WAYPTS);
+	if (route_lib_read(nearest.route, &record) != 0 || !init_nav(nav, route, count)) {
+		bad_route = nearest.route;
+		display_status("BADRTE");
+		return 0;
+	}
+
+	start_route(nav, record.name);
+	return 1;
 }
+#endif
 
 int main(void) {
+	nav_state nav;
+	uint8_t have_fix = 0;
+	uint8_t have_route = 0;
+	uint32_t last_tick = 0;
+	uint16_t tick_ms = TICK_MS;
+	uint8_t aiding_saved = 0;
+	uint32_t aiding_saved_at = 0;
+	uint32_t now;
+
+	init_motors();
+	init_display();
+	uart_init();
+	init_gps();
+	init_clock();
+	init_power();
+	ee_log_init();
+	init_telemetry();
+#ifdef HAVE_COURSE
+	init_sd();
+#else
+	if (init_sd() == 0)
+		route_lib_init();
+#endif
 
-}
\ No newline at end of file
+	nav_default_config(&nav.config);
+
+	// The run clock and UART interrupts wake the CPU
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	sei();
+
+	for (;;) {
+		now = clock_now();
+
+		if (now - last_tick >= tick_ms) {
+			// Late ticks are not made up, the tasks work from the clock time
+			last_tick = now;
+			gps_task();
+
+			if (!have_fix)
+				have_fix = wait_for_gps();
+			else if (!have_route)
+				have_route = select_route(&nav);
+			else {
+				navigate_route(&nav, now);
+				telemetry_run(&nav, now);
+			}
+			telemetry_task(now);
+
+			// The watch may go off any time on a low battery, keep the last fix saved
+			// for a fast next start (run_complete() saves it at the finish)
+			if (power_task() && (!aiding_saved ||
+					now - aiding_saved_at >= LOW_BATTERY_SAVE_MS) && gps_save_aiding() == 0) {
+				aiding_saved = 1;
+				aiding_saved_at = now;
+			}
+
+			motor_tick(tick_ms);
+			display_task();
+
+			// No cues are due while paused, the next fix ends the pause
+			tick_ms = (have_route && nav_paused(&nav)) ? PAUSED_TICK_MS : TICK_MS;
+		} else {
+			sleep_mode();
+		}
+	}
+}
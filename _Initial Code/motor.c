@@ -7,42 +7,74 @@
  * Defines functions used for vibration motor control
  */
 
+#include <avr/io.h>
+#include "motor.h"
+
+// Time left before the motors are turned off (0 = leave them as they are)
+static uint16_t pulse_remaining;
+
 /*
  *
  */
 void init_motors() {
-	DDR = ???;
-	PORT = ???;
+	MOTOR_DDR |= (1 << LEFT_M) | (1 << RIGHT_M);
+	MOTOR_PORT &= ~((1 << LEFT_M) | (1 << RIGHT_M));
+	pulse_remaining = 0;
 }
 
 /*
  *
  */
 void vibrate_left() {
-	PORT |= (1 << LEFT_M);
-	PORT &= ~(1 << RIGHT_M);
+	MOTOR_PORT |= (1 << LEFT_M);
+	MOTOR_PORT &= ~(1 << RIGHT_M);
 }
 
 /*
  *
  */
 void vibrate_right() {
-	PORT |= (1 << RIGHT_M);
-	PORT &= ~(1 << LEFT_M);
+	MOTOR_PORT |= (1 << RIGHT_M);
+	MOTOR_PORT &= ~(1 << LEFT_M);
 }
 
 /*
  *
  */
 void vibrate_both() {
-	PORT |= (1 << LEFT_M);
-	PORT |= (1 << RIGHT_M);
+	MOTOR_PORT |= (1 << LEFT_M);
+	MOTOR_PORT |= (1 << RIGHT_M);
 }
 
 /*
  *
  */
 void vibrate_off() {
-	PORT &= ~(1 << LEFT_M);
-	PORT &= ~(1 << RIGHT_M);
-}
\ No newline at end of file
+	MOTOR_PORT &= ~(1 << LEFT_M);
+	MOTOR_PORT &= ~(1 << RIGHT_M);
+	pulse_remaining = 0;
+}
+
+/*
+ * Turns the motors off once a number of ms have passed, counted by motor_tick()
+ *
+ * ms: length of the pulse
+ */
+void pulse_motors(uint16_t ms) {
+	pulse_remaining = ms;
+}
+
+/*
+ * Counts down the running pulse and ends it when it runs out
+ *
+ * tick_ms: milliseconds since the last call
+ */
+void motor_tick(uint16_t tick_ms) {
+	if (pulse_remaining == 0)
+		return;
+
+	if (pulse_remaining <= tick_ms)
+		vibrate_off();
+	else
+		pulse_remaining -= tick_ms;
+}
@@ -12,16 +12,24 @@
 #ifndef MOTOR_H_
 #define MOTOR_H_
 
-#define LEFT_M 
-#define RIGHT_M
+#include <stdint.h>
 
-// Add timer for pulsing if possible
-// Vibrate end of run?
+#define MOTOR_PORT PORTD
+#define MOTOR_DDR DDRD
+#define LEFT_M PD5
+#define RIGHT_M PD6
+#define CUE_PULSE_MS 400	// length of a turn cue vibration
+#define FINISH_PULSE_MS 2000	// length of the end of run vibration
+#define GHOST_PULSE_MS 150	// length of the vibration when the lead on the ghost changes
 
 void init_motors(void);
 void vibrate_left(void);
 void vibrate_right(void);
 void vibrate_both(void);
 void vibrate_off(void);
+// Turn the running motor(s) off after a number of ms
+void pulse_motors(uint16_t);
+// Count down the motor pulse (called every scheduler tick)
+void motor_tick(uint16_t);
 
-#endif	// MOTOR_H_
\ No newline at end of file
+#endif	// MOTOR_H_
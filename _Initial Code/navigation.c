@@ -5,65 +5,69 @@
  * Author: Joel Heck
  *
  * Navigation function code
- * 
+ *
  * The navigation function guides the user between two latitude/longitude positions.
  * It retrieves formatted GPS data, makes some distance and bearing calculations, and
- * vibrates the motor(s) if necessary to indicate the correct heading to the next 
+ * vibrates the motor(s) if necessary to indicate the correct heading to the next
  * position.
+ *
+ * All route state is kept in a nav_state context owned by the caller. The device
+ * uses a single context, the host simulation tools create one per simulated run.
  */
 
 // #include files
+#include <math.h>
+#include <string.h>
 #include "navigation.h"
+#include "display.h"
+#include "eeprom_log.h"
+#include "ghost.h"
+#include "route_table.h"
+#include "waypt_log.h"
 
 // Macros
-#define ARRAY_LENGTH( x )	(sizeof(x)/sizeof(x[0]))
 
 // Imported global variables and functions
 
 // Exported global variables and functions
 
 // Private variables and functions to file
+static double meters_between(const waypoint*, const waypoint*);
+static uint16_t update_distance(nav_state*, const gps_fix*, float);
+static direction turn_at_waypoint(const nav_state*, int16_t);
+static direction check_waypoint(nav_state*);
+static uint32_t time_to_waypt(const nav_state*, uint16_t);
+static direction scheduled_cue(nav_state*, uint32_t);
+static void show_run(nav_state*, direction, uint32_t);
+static void show_ghost(const ghost_state*, uint32_t);
+static void reset_run(nav_state*);
+static void route_waypt(const nav_state*, uint8_t, waypoint*);
+static int16_t leg_bearing(const nav_state*, uint8_t);
+static direction course_turn(const nav_state*, uint8_t);
+
+/*
+ * This routine fills a configuration with the default distance thresholds.
+ */
+void nav_default_config(nav_config *config) {
+	config->change_distance = CHANGE_DISTANCE;
+	config->notify_distance = NOTIFY_DISTANCE;
+	config->cue_lead_ms = CUE_LEAD_TIME;
+	config->reasonable_distance = REASONABLE_DISTANCE;
+}
 
-typedef struct waypoint {
-	double latitude;
-	double longitude;
-} waypoint;
-
-// Classes, constant definitions, enums, type definitions
-enum direction {
-	STRAIGHT,
-	LEFT,
-	RIGHT,
-	NONE
-};
-
-static waypoint **route;	// array of waypoint structures defining a running route
-static uint8_t num_waypts_in_route;	// number of waypoints in the route
-static uint8_t current_waypt_num;	// index in route of the next waypoint
-static uint32_t elapsed_time;		// seconds since beginning of run
-static waypoint *current_location;	// the current user location
-static waypoint *prev_location;		// the last known user location
-
-static uint16_t total_distance_run;
-/*
- * This routine initializes private class variables and stores the input array in a class
- * variable. It performs basic error checking on the input and returns a value indicating 
- * success or failure.
- */
-boolean init_nav(waypoint *new_route) {
+/*
+ * This routine initializes the navigation context and stores a reference to the input
+ * array. It performs basic error checking on the input and returns a value indicating
+ * success or failure. The route array must stay valid for the whole run. The context
+ * configuration is left as set by the caller (see nav_default_config()).
+ */
+boolean init_nav(nav_state *nav, const waypoint *new_route, uint8_t num_waypts) {
 	// Check that input is valid
-	if (array_valid(new_route)) {
-		// Save input into private array
-		memcpy(route, new_route, sizeof(new_route));
-		
-		// TODO: Initialize private class variables
-		num_waypts_in_route = ARRAY_LENGTH(route);
-		current_waypt_num = 0;
-		elapsed_time = 0;
-		total_distance_run = 0;
-
-		current_location = (waypoint *) malloc(sizeof(waypoint));
-		prev_location = (waypoint *) malloc(sizeof(waypoint));
+	if (array_valid(new_route, num_waypts)) {
+		nav->route = new_route;
+		nav->table = NULL;
+		nav->num_waypts_in_route = num_waypts;
+		reset_run(nav);
 
 		// Return success
 		return TRUE;
@@ -73,76 +77,239 @@ boolean init_nav(waypoint *new_route) {
 	return FALSE;
 }
 
+/*
+ * This routine initializes the navigation context on a route compiled into flash
+ * (see route_table.h). The waypoints, bearings and turns are read from the tables in
+ * place for the whole run.
+ */
+boolean init_nav_table(nav_state *nav, const route_table *table) {
+	uint8_t num_waypts = route_table_size(table);
+
+	if (num_waypts > 2) {
+		nav->route = NULL;
+		nav->table = table;
+		nav->num_waypts_in_route = num_waypts;
+		reset_run(nav);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*
+ * This routine resets the run state of the context for the start of a route.
+ */
+static void reset_run(nav_state *nav) {
+	nav->current_waypt_num = 0;
+	nav->have_prev_location = 0;
+	nav->prev_fix_ms = 0;
+	nav->ms_since_fix = 0;
+	nav->heading = 0;
+	heading_init(&nav->heading_est);
+	pause_init(&nav->pause);
+	nav->last_log_ms = 0;
+	kalman_init(&nav->filter);
+	stats_init(&nav->stats);
+	nav->distance_to_waypt = 0;
+	nav->cue_given = 0;
+	nav->cue_waypt = 0;
+	nav->scheduled_turn = NONE;
+	nav->scheduled_cue_at = 0;
+	nav->last_cue_ms = 0;
+	nav->last_turn = NONE;
+	nav->complete = 0;
+	nav->stats_saved = 0;
+	nav->finish_cued = 0;
+	nav->aiding_saved = 0;
+	nav->turn_shown_at = 0;
+	nav->ghost = NULL;
+}
+
+/*
+ * These routines read the route, from the tables in flash for a compiled route or
+ * from the waypoint array otherwise.
+ */
+static void route_waypt(const nav_state *nav, uint8_t i, waypoint *waypt) {
+	if (nav->table != NULL)
+		route_table_waypt(nav->table, i, waypt);
+	else
+		*waypt = nav->route[i];
+}
+
+static int16_t leg_bearing(const nav_state *nav, uint8_t i) {
+	if (nav->table != NULL)
+		return route_table_bearing(nav->table, i);
+
+	return bearing_to_waypt(&nav->route[i], &nav->route[i + 1]);
+}
+
+/*
+ * This routine gives the turn the course makes at a waypoint, from the leg that
+ * ends at it to the leg that leaves it. There is no turn at the first and last.
+ */
+static direction course_turn(const nav_state *nav, uint8_t i) {
+	if (nav->table != NULL)
+		return route_table_turn(nav->table, i);
+
+	if (i == 0 || i + 1 >= nav->num_waypts_in_route)
+		return NONE;
+
+	return direction_to_turn(leg_bearing(nav, i - 1), leg_bearing(nav, i), 1);
+}
+
 /*
  * This routine checks that the input array has more than two values, and is not NULL.
  * Returns a value indicating valid or not.
  */
-boolean array_valid(waypoint *test_route) {
+boolean array_valid(const waypoint *test_route, uint8_t num_waypts) {
 	// Check if array not NULL
 	if (test_route != NULL) {
-		
+
 		// Check if array has more than two values
-		if (ARRAY_LENGTH(test_route) > 2) {
+		if (num_waypts > 2) {
 			return TRUE;
 		}
 	}
-	
+
 	return FALSE;
 }
 
 /*
- * This routine calculates the equirectangular approximation of the distance between two 
- * (latitude, longitude) waypoints in meters. This approximation should work for 
+ * This routine calculates the equirectangular approximation of the distance between two
+ * (latitude, longitude) waypoints in meters. This approximation should work for
  * distances of at least 100 km.
  */
-uint16_t dist_between_waypts(waypoint *first_waypt, waypoint *second_waypt) {
+static double meters_between(const waypoint *first_waypt, const waypoint *second_waypt) {
 	// Convert input latitudes/longitudes to radians
-	double longitude_difference = (second_waypt.longitude - first_waypt.longitude) 
+	double longitude_difference = (second_waypt->longitude - first_waypt->longitude)
 		* (double) DEG_TO_RAD;
 
-	double latitude_difference = (second_waypt.latitude - first_waypt.latitude)
+	double latitude_difference = (second_waypt->latitude - first_waypt->latitude)
 		* (double) DEG_TO_RAD;
 
-	double latitude_average = ( (second_waypt.latitude + first_waypt.latitude) 
+	double latitude_average = ( (second_waypt->latitude + first_waypt->latitude)
 		* (double) DEG_TO_RAD ) / 2.0;
 
 	double x_coord = longitude_difference * cos(latitude_average);
 	double y_coord = latitude_difference;
-	
+
+	return sqrt((x_coord * x_coord) + (y_coord * y_coord)) * EARTH_RADIUS;
+}
+
+/*
+ * This routine gives the distance between two waypoints in whole meters (see
+ * meters_between()), saturated at 65535.
+ */
+uint16_t dist_between_waypts(const waypoint *first_waypt, const waypoint *second_waypt) {
+	double distance = meters_between(first_waypt, second_waypt);
+
 	// Convert to integer as double precision not necessary
-	uint16_t distance = (uint16_t) ( sqrt((x * x) + (y * y)) * EARTH_RADIUS);
+	if (distance > 65535.0)
+		return 65535;
+
+	return (uint16_t) distance;
+}
+
+/*
+ * Finds the bearing between two (latitude, longitude) positions in degrees
+ *
+ * from: first position
+ * to: second position
+ *
+ * return: integer bearing from the first position to the second position
+ * 		   in degrees (0-359)
+ */
+int16_t bearing_to_waypt(const waypoint *from, const waypoint *to) {
+	double dLong = (to->longitude - from->longitude) * DEG_TO_RAD;
+	double lat = from->latitude * DEG_TO_RAD;
+	double next_lat = to->latitude * DEG_TO_RAD;
+	double dy = sin(dLong)*cos(next_lat);
+	double dx = cos(lat)*sin(next_lat) - sin(lat)*cos(next_lat)*cos(dLong);
+	int16_t result = (int16_t)(atan2(dy,dx)*RAD_TO_DEG);
+
+	if (result >= 0)
+		return result;
+	else
+		return 360+result;
+}
+
+/*
+ * Finds the direction to turn to reach the active waypoint if off-track or
+ * transitioning to the next waypoint. Only gives an indication to turn if
+ * the user's bearing is more than TURN_INDICATE degrees from the expected bearing
+ *
+ * actual: the actual bearing of the user in integer degrees (0-360)
+ * expected: the bearing the user should follow in integer degrees (0-360)
+ * next: an integer (0 or 1) to indicate if transitioning to a new waypoint
+ *
+ * return: the direction to turn, or NONE if on track or the input is out of
+ * 		bounds
+ */
+direction direction_to_turn(int16_t actual, int16_t expected, uint8_t next) {
+	if (actual > 360 || expected > 360 || actual < 0 || expected < 0)
+		return NONE;	// Error (input must be in range [0,360])
+
+	int16_t diff = expected - actual;
+	int16_t absD = (diff < 0) ? -diff : diff;
+
+	// Fold the difference into the range [0,180]
+	if (absD > 180) {
+		absD = 360 - absD;
+		diff = -diff;
+	}
 
-	return distance;
+	if (absD > TURN_INDICATE || next == 1) {
+		if (absD <= TURN_INDICATE)
+			return STRAIGHT;
+		else if (absD == 180)
+			return LEFT;	// Arbitrarily chose turn left
+		else
+			return (diff < 0) ? LEFT : RIGHT;
+	}
+
+	return NONE;
 }
 
 /*
- * This routine updates the total distance completed and distance remaining to the next
- * waypoint based on the distance traveled since the last routine call. It also updates
- * the previous location of the user with the current location.
+ * This routine updates the run statistics and distance remaining to the next waypoint
+ * based on the distance traveled since the last routine call. It also updates the
+ * previous location of the user with the current location.
+ *
+ * fix: the fix the current location came from
+ * dt: seconds since the previous fix
  */
-uint16_t update_distance() {
-	uint16_t distance_covered = dist_between_waypts(prev_location, current_location);
-	
-	// If the distance traveled in the last second is reasonable
-	if (distance_covered <= REASONABLE_DISTANCE) {
-		
-		// Add the distance to the total distance for the run
-		total_distance_run += distance_covered;
-		
-		// Find the distance to the next waypoint
-		return dist_between_waypts(current_location, route[current_waypt_num]);
+static uint16_t update_distance(nav_state *nav, const gps_fix *fix, float dt) {
+	waypoint next_waypt;
+
+	if (nav->have_prev_location) {
+		double distance_covered = meters_between(&nav->prev_location,
+			&nav->current_location);
+		uint16_t covered_cm = 0;
+
+		// If the distance traveled since the last fix is reasonable
+		if (distance_covered <= nav->config.reasonable_distance && distance_covered < 655.0)
+			covered_cm = (uint16_t)(distance_covered * 100);
+
+		// Add the distance to the statistics for the run
+		stats_update(&nav->stats, covered_cm, (dt < 65.0) ? (uint16_t)(dt * 1000) : 65000,
+			kalman_speed(&nav->filter), fix->altitude);
 	}
 
-	// Do nothing otherwise
+	nav->prev_location = nav->current_location;
+	nav->have_prev_location = 1;
+
+	// Find the distance to the next waypoint
+	route_waypt(nav, nav->current_waypt_num, &next_waypt);
+	return dist_between_waypts(&nav->current_location, &next_waypt);
 }
 
 /*
  * This routine indicates whether or not the user is within a certain distance of the next
  * waypoint, but not at the waypoint.
  */
-boolean near_waypoint(uint16_t distance) {
-	if (distance <= (uint16_t) NOTIFY_DISTANCE) {
-		if (distance > (uint16_t) CHANGE_DISTANCE) {
+boolean near_waypoint(const nav_state *nav, uint16_t distance) {
+	if (distance <= nav->config.notify_distance) {
+		if (distance > nav->config.change_distance) {
 			return TRUE;
 		}
 	}
@@ -150,12 +317,67 @@ boolean near_waypoint(uint16_t distance) {
 	return FALSE;
 }
 
+/*
+ * This routine indicates whether or not it is time to cue the turn at the next
+ * waypoint. The cue is given when the time to reach the waypoint at the current
+ * filtered speed drops to the configured lead time, so it arrives the same time
+ * ahead of the turn at any pace. When the user is barely moving the time to arrive
+ * means nothing and the fixed notify distance is used instead.
+ */
+boolean cue_due(const nav_state *nav, uint16_t distance) {
+	uint32_t eta = time_to_waypt(nav, distance);
+
+	if (distance <= nav->config.change_distance)
+		return FALSE;
+
+	if (eta == UINT32_MAX)
+		return near_waypoint(nav, distance);
+
+	if (eta <= nav->config.cue_lead_ms)
+		return TRUE;
+
+	return FALSE;
+}
+
+/*
+ * This routine estimates the time to reach the next waypoint at the filtered speed.
+ *
+ * return: milliseconds to arrive, or UINT32_MAX when the user is barely moving
+ */
+static uint32_t time_to_waypt(const nav_state *nav, uint16_t distance) {
+	float speed = kalman_speed(&nav->filter);
+
+	if (speed < CUE_MIN_SPEED)
+		return UINT32_MAX;
+
+	return (uint32_t)(distance * 1000.0f / speed);
+}
+
+/*
+ * This routine gives a cue left for the scheduler once it is due.
+ *
+ * now: run clock time in ms
+ */
+static direction scheduled_cue(nav_state *nav, uint32_t now) {
+	direction turn = nav->scheduled_turn;
+
+	if (turn == NONE)
+		return NONE;
+
+	// Not due yet (compared as a difference so clock wraparound is harmless)
+	if ((int32_t)(now - nav->scheduled_cue_at) < 0)
+		return NONE;
+
+	nav->scheduled_turn = NONE;
+	return turn;
+}
+
 /*
  * This routine indicates whether or not the user is at the next waypoint. This means
  * that the user is within a smaller distance than being near the waypoint.
  */
-boolean at_waypoint(uint16_t distance) {
-	if (distance <= (uint16_t) CHANGE_DISTANCE) {
+boolean at_waypoint(const nav_state *nav, uint16_t distance) {
+	if (distance <= nav->config.change_distance) {
 		return TRUE;
 	}
 
@@ -163,80 +385,344 @@ boolean at_waypoint(uint16_t distance) {
 }
 
 /*
- * This is the main routine of the class and runs the user route navigation between 
- * waypoints. It is called roughly every second to update the user about the next
- * waypoint and keep track of the route state.
+ * This routine finds the turn to make at the next waypoint by comparing the user's
+ * heading with the bearing of the leg that starts at that waypoint. Until the
+ * heading is known the turn of the course itself is given.
  */
-uint8_t navigate_route() {
-	// Retrieve latest GPS data
-	// If data valid
-	if (update_gps()) {
-		
-		// If not end of route
-		if (current_waypt_num <= num_waypts_in_route) {
-			
-			// Update the time of the run
-			elapsed_time++;
-
-			// Update the distance to next waypoint
-			current_location->latitude = get_latitude();
-			current_location->longitude = get_longitude();
-			
-			uint16_t distance_to_waypt = update_distance();
-				
-			
-			// Vibrate motors if near next waypt, at a turn, or off course
-			// Update waypoints if at the next waypoint
-			// If near next waypt
-			if (near_waypoint(distance_to_waypt)) {
-				// Vibrate motor in direction of following waypoint
-				if (current_waypt_num < num_waypts_in_route) {
-					// Find bearing to the next waypoint
-					int16_t waypt_bearing = bearing_to_waypt(current_location, 
-						route[current_waypt_num]);
-
-					int16_t user_heading = get_heading();
-
-					// Find the direction for user to turn
-					direction turn_direction = direction_to_turn(user_heading, waypt_bearing);
-
-					indicate_turn_direction(turn_direction);
-				}
-				// If next waypoint does not exist (end of route)
-					// Do nothing
-				// Vibrate motors to indicate direction of waypoint
-			}
-			// If at the next waypt
-			else if (at_waypoint(distance_to_waypt)) {
-				// If route not finished
-					// Vibrate motor in direction of following waypoint
-					// Find direction of next waypoint (left, right, straight)
-					// Vibrate motors to indicate direction of waypoint
-					// Update waypoint index
-				// Else run complete
-			}
-			// If off course
-			else if (off_course()) {
-				// Vibrate motor in direction of waypoint
+static direction turn_at_waypoint(const nav_state *nav, int16_t user_heading) {
+	uint8_t next = nav->current_waypt_num;
+
+	// No turn after the last waypoint
+	if (next + 1 >= nav->num_waypts_in_route)
+		return NONE;
+
+	if (!heading_valid(&nav->heading_est))
+		return course_turn(nav, next);
+
+	return direction_to_turn(user_heading, leg_bearing(nav, next), 1);
+}
+
+/*
+ * This routine cues the turn after the next waypoint when the user is about to reach
+ * it and moves on to the following waypoint once the user reaches it. It works on the
+ * last distance to the waypoint, measured or predicted, and is run every scheduler
+ * tick so the cue time is accurate to one tick rather than one fix.
+ */
+static direction check_waypoint(nav_state *nav) {
+	direction turn = NONE;
+
+	// If the next waypt is close in time, cue the turn that follows it once
+	if (cue_due(nav, nav->distance_to_waypt)) {
+		if (!nav->cue_given) {
+			turn = turn_at_waypoint(nav, nav->heading);
+			nav->cue_waypt = nav->current_waypt_num;
+			nav->cue_given = 1;
+		}
+	}
+	// If at the next waypt, move on to the following one
+	else if (at_waypoint(nav, nav->distance_to_waypt)) {
+		if (!nav->cue_given) {
+			uint32_t eta = time_to_waypt(nav, nav->distance_to_waypt);
+
+			turn = turn_at_waypoint(nav, nav->heading);
+			nav->cue_waypt = nav->current_waypt_num;
+
+			// Slow enough that the turn is still more than the lead time away: leave
+			// the cue to the scheduler rather than give it early
+			if (turn != NONE && eta != UINT32_MAX && eta > nav->config.cue_lead_ms) {
+				nav->scheduled_turn = turn;
+				nav->scheduled_cue_at = nav->prev_fix_ms + nav->ms_since_fix +
+					(eta - nav->config.cue_lead_ms);
+				turn = NONE;
 			}
+		}
 
+		nav->current_waypt_num++;
+		nav->cue_given = 0;
 
-			// Update the display
-			
-			// Stop vibrating motors
-			
-			// Save the current latitude and longitude
-			memcpy(prev_location, current_location, sizeof(waypoint));
+		// Else run complete
+		if (nav->current_waypt_num >= nav->num_waypts_in_route) {
+			nav->current_waypt_num = nav->num_waypts_in_route - 1;
+			nav->complete = 1;
 		}
-		// Else 
-			// Vibrate motors
-			// Store statistics on first iteration
-			// Update the display with finishing message
 	}
-	// Else
-		// Update the time of the run
-	
-	// Update display or just update the time
+	// If off course
+		// Vibrate motor in direction of waypoint
+
+	return turn;
+}
+
+/*
+ * This routine advances the navigation of one route by one GPS fix. The fix is run
+ * through the position filter and the distances are updated from the filtered
+ * position. Times come from the fix's run clock stamp, not from counting calls. It
+ * returns the turn to cue, or NONE if no cue should be given. It has no side effects
+ * outside of the context so it can be replayed against recorded runs.
+ */
+direction nav_update(nav_state *nav, const gps_fix *fix) {
+	direction turn;
+	int16_t heading;
+	float dt = 1.0;
+
+	if (!fix->valid || nav->complete)
+		return NONE;
+
+	// Time since the last fix
+	if (nav->have_prev_location && fix->stamp != nav->prev_fix_ms)
+		dt = (fix->stamp - nav->prev_fix_ms) / 1000.0f;
+
+	kalman_update(&nav->filter, fix, dt);
+	kalman_position(&nav->filter, 0, &nav->current_location.latitude,
+		&nav->current_location.longitude);
+
+	// While paused only the run time goes on. The location before the pause is kept,
+	// so the distance counted on resuming is the real one and not the jitter. A cue
+	// waiting for the scheduler is held back by the time paused, so a user stopped
+	// at the corner still gets it once moving again.
+	if (pause_update(&nav->pause, fix, kalman_speed(&nav->filter))) {
+		if (nav->scheduled_turn != NONE)
+			nav->scheduled_cue_at += fix->stamp - nav->prev_fix_ms;
+		nav->prev_fix_ms = fix->stamp;
+		nav->ms_since_fix = 0;
+		if (nav->have_prev_location)
+			stats_update(&nav->stats, 0, (dt < 65.0) ? (uint16_t)(dt * 1000) : 65000, 0,
+				fix->altitude);
+		return NONE;
+	}
+
+	turn = scheduled_cue(nav, fix->stamp);
+	nav->prev_fix_ms = fix->stamp;
+	nav->ms_since_fix = 0;
+
+	// The filter's heading is steadiest when moving. Below the speed the receiver's
+	// course is good from, the estimator takes the heading from the displacement of
+	// recent fixes (or the course, if the receiver already reports that speed).
+	heading = heading_update(&nav->heading_est, fix);
+	if (kalman_speed(&nav->filter) > FILTER_HEADING_SPEED)
+		nav->heading = kalman_heading(&nav->filter);
+	else
+		nav->heading = heading;
+
+	// Update the distance to next waypoint
+	nav->distance_to_waypt = update_distance(nav, fix, dt);
+
+	// A scheduled cue takes this update, the waypoint is checked again next tick
+	if (turn == NONE)
+		turn = check_waypoint(nav);
+
+	if (turn != NONE) {
+		nav->last_cue_ms = fix->stamp;
+		nav->last_turn = turn;
+	}
+
+	return turn;
+}
+
+/*
+ * This routine advances the navigation by one scheduler tick between fixes. The
+ * user position is predicted from the filter so the waypoint checks don't wait up to
+ * a second for the next fix.
+ *
+ * now: run clock time in ms
+ */
+direction nav_tick(nav_state *nav, uint32_t now) {
+	waypoint predicted;
+	waypoint next_waypt;
+	uint32_t since_fix;
+	direction turn;
+
+	if (!nav->have_prev_location || nav->complete || nav->pause.paused)
+		return NONE;
+
+	turn = scheduled_cue(nav, now);
+
+	since_fix = now - nav->prev_fix_ms;
+	nav->ms_since_fix = (since_fix < KF_MAX_PREDICT) ? (uint16_t)since_fix : KF_MAX_PREDICT;
+
+	kalman_position(&nav->filter, nav->ms_since_fix, &predicted.latitude,
+		&predicted.longitude);
+	route_waypt(nav, nav->current_waypt_num, &next_waypt);
+	nav->distance_to_waypt = dist_between_waypts(&predicted, &next_waypt);
+
+	if (turn == NONE)
+		turn = check_waypoint(nav);
+
+	if (turn != NONE) {
+		nav->last_cue_ms = now;
+		nav->last_turn = turn;
+	}
+
+	return turn;
+}
+
+/*
+ * This routine tells whether the run is auto-paused (the user is stopped). The
+ * scheduler uses it to tick less often.
+ */
+uint8_t nav_paused(const nav_state *nav) {
+	return nav->pause.paused;
+}
+
+/*
+ * This is the main routine of the class and runs the user route navigation between
+ * waypoints. It is called every scheduler tick to update the user about the next
+ * waypoint and keep track of the route state. New GPS data (about once a second)
+ * updates the route, the ticks in between work from the predicted position.
+ *
+ * now: run clock time in ms
+ *
+ * return: 1 while the route is in progress, 0 once it is complete
+ */
+uint8_t navigate_route(nav_state *nav, uint32_t now) {
+	direction turn;
+	gps_fix fix;
+
+	// Retrieve latest GPS data
+	if (gps_data_ready()) {
+		if (update_gps())
+			get_fix(&fix);
+		else
+			fix.valid = 0;
+
+		turn = nav_update(nav, &fix);
+
+		// Log the fix and race the reference run (a turn cue takes the motors first).
+		// While paused a fix is only logged every PAUSED_LOG_MS to keep the track going.
+		if (fix.valid && (!nav->pause.paused || now - nav->last_log_ms >= PAUSED_LOG_MS)) {
+			waypt_log_fix(&nav->stats, &nav->current_location);
+			nav->last_log_ms = now;
+			if (!nav->pause.paused && nav->ghost != NULL &&
+					ghost_update(nav->ghost, &nav->stats) && turn == NONE) {
+				vibrate_both();
+				pulse_motors(GHOST_PULSE_MS);
+			}
+		}
+	} else {
+		turn = nav_tick(nav, now);
+	}
+
+	indicate_turn_direction(turn);
+
+	// Update the display (only changed characters are sent)
+	show_run(nav, turn, now);
+
+	if (nav->complete) {
+		run_complete(nav);
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * This routine puts the gap to the ghost in the status field.
+ */
+static void show_ghost(const ghost_state *ghost, uint32_t now) {
+	char text[8];
+
+	ghost_text(ghost, now, text);
+	display_status(text);
+}
+
+/*
+ * This routine puts the run information on the display. The turn arrow stays up for
+ * TURN_DISPLAY_MS after a cue.
+ */
+static void show_run(nav_state *nav, direction turn, uint32_t now) {
+	display_time(nav->stats.elapsed_ms);
+	display_distance(nav->stats.distance);
+	display_pace(stats_pace(&nav->stats, 0));
+
+	if (turn != NONE) {
+		display_turn((turn == LEFT) ? '<' : (turn == RIGHT) ? '>' : '^');
+		nav->turn_shown_at = now;
+	} else if (now - nav->turn_shown_at >= TURN_DISPLAY_MS) {
+		display_turn(' ');
+	}
+
+	if (nav->complete)
+		display_status("FINISH");
+	else if (!is_fix_valid())
+		display_status("NO FIX");
+	else if (nav->pause.paused)
+		display_status("PAUSED");
+	else if (nav->ghost != NULL)
+		show_ghost(nav->ghost, now);
+	else
+		display_status("");
+}
+
+/*
+ * This routine pulses the motor(s) to indicate a turn direction. STRAIGHT pulses
+ * both motors, NONE does nothing. The scheduler ends the pulse (see motor_tick()).
+ */
+void indicate_turn_direction(direction turn) {
+	switch (turn) {
+		case LEFT:
+			vibrate_left();
+			break;
+		case RIGHT:
+			vibrate_right();
+			break;
+		case STRAIGHT:
+			vibrate_both();
+			break;
+		default:
+			return;
+	}
+
+	pulse_motors(CUE_PULSE_MS);
+}
+
+/*
+ * Private function for handling completed runs. It is called every tick once the
+ * run is complete and keeps trying to start the save until the EEPROM is free.
+ */
+void run_complete(nav_state *nav) {
+	if (!nav->finish_cued) {
+		vibrate_both();		// Long pulse on both motors for the finish
+		pulse_motors(FINISH_PULSE_MS);
+		nav->finish_cued = 1;
+		waypt_log_finish();		// This run is the ghost of the next one
+		/*PRINT MSGS*/
+	}
+
+	if (!nav->stats_saved) {	// Save run statistics in the background
+		run_summary summary;
+
+		stats_summary(&nav->stats, &summary);
+		if (ee_log_save(&summary) == 0)
+			nav->stats_saved = 1;
+	} else if (!nav->aiding_saved) {	// Then the last fix for a fast next start
+		if (gps_save_aiding() == 0)
+			nav->aiding_saved = 1;
+	}
+}
+
+/*
+ * This routine shows the progress of the GPS start on the display. It does not
+ * block: it is called every scheduler tick until the first valid fix arrives.
+ *
+ * return: 1 once a valid fix has been received, 0 while still waiting
+ */
+uint8_t wait_for_gps() {
+	char text[7];
+	uint8_t sats;
+
+	if (gps_data_ready() && update_gps()) {
+		display_status("GPS OK");
+		return 1;
+	}
+
+	// "AID 05" with a saved position given to the module, "SAT 05" without
+	sats = get_satellites();
+	strcpy(text, gps_aided() ? "AID " : "SAT ");
+	text[4] = '0' + (sats / 10) % 10;
+	text[5] = '0' + sats % 10;
+	text[6] = 0;
+	display_status(text);
+
+	return 0;
 }
 
 
@@ -252,4 +738,4 @@ uint8_t navigate_route() {
  * Write the routine declaration and first and last statements
  * Fill in code below comments
  * Check code and clean up
- */
\ No newline at end of file
+ */
@@ -4,190 +4,132 @@
  * Created: 2013/12/24
  * Author: Joel Heck
  *
- * Header for navigation code 
- * 
- * Navigation function code
+ * Header for navigation code
+ *
+ * Defines the navigation context and declares the navigation functions. All
+ * route state lives in a nav_state structure so that more than one route can
+ * be navigated at a time (the host simulation tools run thousands at once).
  */
 
+#ifndef NAVIGATION_H_
+#define NAVIGATION_H_
+
+#include <stdint.h>
+#include "auto_pause.h"
+#include "gps.h"
+#include "heading.h"
+#include "kalman.h"
 #include "motor.h"
+#include "run_stats.h"
 
 #define DEG_TO_RAD 0.017453		// pi/180
+#define RAD_TO_DEG 57.29578		// 180/pi
 #define EARTH_RADIUS 6371000	// meters
 #define REASONABLE_DISTANCE 100		// meters
 #define CHANGE_DISTANCE 20 	// meters
 #define NOTIFY_DISTANCE 40 	// meters
+#define TURN_INDICATE 60	// degrees off the expected bearing before a turn is indicated
+#define MAX_WAYPTS 255		// largest route a uint8_t waypoint index can hold
+// m/s above which the filtered heading is used, the speed the receiver's course
+// becomes reliable at (below it the heading estimator is used)
+#define FILTER_HEADING_SPEED (HEADING_COURSE_SPEED / 3.6)
+#define CUE_LEAD_TIME 6000	// ms before reaching a waypoint to give the turn cue
+#define CUE_MIN_SPEED 0.5	// m/s below which cues fall back to NOTIFY_DISTANCE
+#define TURN_DISPLAY_MS 10000	// time the turn arrow stays on the display
+#define PAUSED_LOG_MS 10000	// time between logged fixes while paused
+
+#ifndef NULL
 #define NULL 0
-
-
-enum boolean {
-	TRUE = 1,
-	FALSE = (!TRUE)
-};
-
-
-
-void init_nav(void);
-void navigate_route(void);
-void run_complete(void);
-void run_motors(void);
-void wait_for_gps(void);
-
-uint16_t dist_between_waypts(double, double, double, double);
-int16_t bearing_to_waypt(double, double, double, double);
-int8_t dir_to_waypt(int16_t, int16_t, uint8_t);
-
-//*********************************************************
-static uint32_t elapsed_time;
-static uint8_t stats_saved;
-static uint16_t dist_rem;      // Distance to next waypt (meters)
-static double dist_done;        // Current completed distance (kilometers)
-static uint16_t dist_covered;	// Distance covered in last second
-
-/*
- * Initialize certain navigation parameters with the selected route
- */
-void init_nav(/*INSERT ROUTE SELECTION*/) {
- 	elapsed_time = 0;
- 	stats_saved = 0;
- 	dist_done = 0;
- 	dist_rem = 0;	/*INSERT DISTANCE B/T FIRST TWO WAYPOINTS*/
-}
-
-/*
- * Run through the navigation sequence (called once a second)
- */
-void navigate_route() {
-	
-	if(update_gps()) {	// Parse latest data, valid data
-		if (/*INSERT END OF ROUTE CHECK*/)
-			run_complete();
-		else {
-			elapsed_time++;
-
-			update_distances();
-			//bear = bearing_to_waypt(/*INSERT WAYPTS*/);
-
-			update_waypts();
-		}
-	} else {	// Invalid data
-		elapsed_time++;
-	}
-
-	/*PRINT NEW INFORMATION*/
-}
-
-/*
- *
- */
-static void update_waypts() {
-	if (dist_rem < (uint16_t)NEAR_DIST) {
-		/*UPDATE THE WAYPT INDEX*/
-		if (/*WAYPT IS NOT LAST*/) {
-			indicate_turn_dir();
-		}
-	}
-}
-
-/*
- *
- */
-static void indicate_turn_dir(/*INSERT ARGS*/) {
- 	/*CALCULATE BEARING
- 	 *CALL dir_to_waypt()
- 	 *CALL run_motors()*/
-}
-
-
-/*
- * Private function for handling completed runs
- */
-void run_complete() {
-	if(!stats_saved) {	// Save run statistics
-		vibrate_both();		// Vibrate motors (INSERT end of run function?)
-		stats_saved++;
-		/*INSERT SAVE STATS TO EEPROM*/
-		/*PRINT MSGS*/
-	}
-
-	vibrate_off();
-}
-
-/*
- *
- */
-void run_motors(/*INSERT ARGS*/) {
-	
-}
-
-/*
- *
- */
-void wait_for_gps(/*INSERT ARGS*/) {
- 	/*INSERT PRINT STATEMENTS*/
-}
-
-
-/*
- * Finds the bearing between two (latitude, longitude) positions in degrees
- *
- * lat: latitude in decimal degrees of first position
- * lon: longitude in decimal degrees of first position
- * next_lat: latitude in decimal degrees of second position
- * next_lon: longitude in decimal degrees of second position
- *
- * return: integer bearing from the first position to the second position
- * 		   in degrees
- */
-int16_t bearing_to_waypt(double lat, double lon, double next_lat, double next_lon) {
-	double dLong = next_lon-lon;
-	double dy = sin(dLong*DEGRAD)*cos(next_lat*DEGRAD);
-	double dx = cos(lat*DEGRAD)*sin(next_lat*DEGRAD)-
-		sin(lat*DEGRAD)*cos(next_lat*DEGRAD)*cos(dLong*DEGRAD);
-	int16_t result = (int16_t)(atan2(dy,dx)*57.3);	// 57.3 = 180/pi
-	
-	if (result > 0) 
-		return result;
-	else
-		return 360+result;
-}
-
-/*
- * Finds the direction to turn to reach the active waypoint if off-track or 
- * transitioning to the next waypoint. Only gives an indication to turn if 
- * the user's bearing is more than 60 degrees from the expected bearing
- *
- * actual: the actual bearing of the user in integer degrees (0-360)
- * expected: the bearing from the user's current position to the active 
- * 		waypoint in integer degrees (0-360)
- * next: an integer (0 or 1) to indicate if transitioning to a new waypoint
- *
- * return: an integer giving the direction to turn (if any) or an error
- * 		-2 = input out of bounds, -1 = turn left, 0 = straight, 1 = turn right
- * 		2 = do nothing (on track)
- */
-int8_t dir_to_waypt(int16_t actual, int16_t expected, uint8_t next) {
-	if (actual > 360 || expected > 360 || actual < 0 || expected < 0)
-		return -2;	// Error (input must be in range [0,360])
-
-	int16_t diff = expected - actual;
-	int16_t absD = (diff < 0) ? -diff : diff;
-
-	if (absD > TURN_IND || next == 1) {
-		if (absD == 0)
-			return 0;
-		else if (absD < 180)
-			return (diff < 0) ? -1 : 1;
-		else if (absD == 180)
-			return -1;	// Arbitrarily chose turn left
-		else if (expected > actual) {
-			if (((actual+360)-expected) > TURN_IND)	
-				return -1;
-		}
-		else {
-			if (((expected+360)-actual) > TURN_IND)	
-				return 1;
-		}
-	}
-
-	return 2;
-}
\ No newline at end of file
+#endif
+
+typedef enum boolean {
+	FALSE = 0,
+	TRUE = (!FALSE)
+} boolean;
+
+// Direction to turn to reach the next waypoint
+typedef enum direction {
+	STRAIGHT,
+	LEFT,
+	RIGHT,
+	NONE
+} direction;
+
+// A (latitude, longitude) position in decimal degrees
+typedef struct waypoint {
+	double latitude;
+	double longitude;
+} waypoint;
+
+// Distance thresholds used to decide when to cue and change waypoints
+typedef struct nav_config {
+	uint16_t change_distance;		// meters from a waypoint to count it as reached
+	uint16_t notify_distance;		// meters from a waypoint to cue when barely moving
+	uint16_t cue_lead_ms;			// time before reaching a waypoint to give the turn cue
+	uint16_t reasonable_distance;	// largest believable distance between two fixes
+} nav_config;
+
+// Navigation context for one route
+typedef struct nav_state {
+	const waypoint *route;			// waypoints defining a running route
+	const struct route_table *table;	// route compiled into flash (route_table.h), or NULL
+	uint8_t num_waypts_in_route;	// number of waypoints in the route
+	uint8_t current_waypt_num;		// index in route of the next waypoint
+	waypoint current_location;		// the filtered user location at the last fix
+	waypoint prev_location;			// the filtered user location at the fix before
+	uint8_t have_prev_location;		// prev_location holds a valid fix
+	kalman_state filter;			// position/velocity filter fed by every fix
+	uint32_t prev_fix_ms;			// run clock time of the last fix
+	uint16_t ms_since_fix;			// run clock time from the last fix to the last tick
+	heading_state heading_est;		// low-speed heading from recent fixes
+	pause_state pause;				// stopped at a light or aid station
+	uint32_t last_log_ms;			// run clock time of the last logged fix
+	int16_t heading;				// user heading in degrees
+	run_stats stats;				// distance, splits, pace and elevation of the run
+	uint16_t distance_to_waypt;		// meters from the user to the next waypoint
+	uint8_t cue_given;				// turn cue already given for the next waypoint
+	uint8_t cue_waypt;				// waypoint the last turn cue was for
+	direction scheduled_turn;		// cue left for the scheduler to give, or NONE
+	uint32_t scheduled_cue_at;		// run clock time the scheduled cue is due
+	uint32_t last_cue_ms;			// run clock time of the last cue given
+	direction last_turn;			// turn of the last cue given
+	uint8_t complete;				// last waypoint reached
+	uint8_t stats_saved;			// run statistics handed to the EEPROM log
+	uint8_t finish_cued;			// end of run vibration given
+	uint8_t aiding_saved;			// last fix saved for the next GPS start
+	uint32_t turn_shown_at;			// run clock time the turn arrow was shown
+	struct ghost_state *ghost;		// reference run to race (ghost.h), or NULL
+	nav_config config;
+} nav_state;
+
+// Fill a configuration with the default distance thresholds
+void nav_default_config(nav_config*);
+// Start a new run on the given route
+boolean init_nav(nav_state*, const waypoint*, uint8_t);
+// Start a new run on a route compiled into flash
+boolean init_nav_table(nav_state*, const struct route_table*);
+// Check that a route can be navigated
+boolean array_valid(const waypoint*, uint8_t);
+// Advance the navigation with one GPS fix and return the turn to cue (if any)
+direction nav_update(nav_state*, const gps_fix*);
+// Advance the navigation to a run clock time between fixes
+direction nav_tick(nav_state*, uint32_t);
+// Tells whether the run is auto-paused
+uint8_t nav_paused(const nav_state*);
+// Run through the navigation sequence (called every scheduler tick)
+uint8_t navigate_route(nav_state*, uint32_t);
+// Handle the end of the run
+void run_complete(nav_state*);
+// Vibrate the motors to indicate a turn direction
+void indicate_turn_direction(direction);
+// Show GPS start progress, returns 1 once the first valid fix arrives
+uint8_t wait_for_gps(void);
+
+uint16_t dist_between_waypts(const waypoint*, const waypoint*);
+int16_t bearing_to_waypt(const waypoint*, const waypoint*);
+direction direction_to_turn(int16_t, int16_t, uint8_t);
+boolean near_waypoint(const nav_state*, uint16_t);
+boolean cue_due(const nav_state*, uint16_t);
+boolean at_waypoint(const nav_state*, uint16_t);
+
+#endif	// NAVIGATION_H_
@@ -0,0 +1,54 @@
+/*
+ * power.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Battery monitor
+ */
+
+#include <avr/io.h>
+#include "power.h"
+
+// Last battery reading
+static uint16_t battery;
+// Low readings in a row
+static uint8_t low_readings;
+
+/*
+ * Sets up the ADC on the battery divider and starts the first conversion
+ */
+void init_power() {
+	battery = 0;
+	low_readings = 0;
+
+	ADMUX = (1 << REFS0) | BATTERY_ADC;		// AVcc reference
+	ADCSRA = (1 << ADEN) | (1 << ADPS2) | (1 << ADPS1);	// F_CPU / 64
+	ADCSRA |= (1 << ADSC);
+}
+
+/*
+ * Takes the finished conversion, if any, and starts the next one
+ *
+ * return: 1 once BATTERY_LOW_READINGS low readings came in a row, 0 otherwise
+ */
+uint8_t power_task() {
+	if (!(ADCSRA & (1 << ADSC))) {
+		battery = (uint16_t)((uint32_t)ADC * ADC_REF_MV * BATTERY_DIVIDER / 1024);
+		ADCSRA |= (1 << ADSC);
+
+		if (battery >= BATTERY_LOW_MV)
+			low_readings = 0;
+		else if (low_readings < BATTERY_LOW_READINGS)
+			low_readings++;
+	}
+
+	return low_readings == BATTERY_LOW_READINGS;
+}
+
+/*
+ * Gives the last battery reading in millivolts
+ */
+uint16_t battery_mv() {
+	return battery;
+}
@@ -0,0 +1,33 @@
+/*
+ * power.h
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Header for the battery monitor
+ *
+ * The battery is measured through a divider on an ADC pin, one conversion per
+ * scheduler tick without waiting for it. A few low readings in a row mean the
+ * watch is about to lose power, which is when the state for the next start has
+ * to be saved.
+ */
+
+#ifndef POWER_H_
+#define POWER_H_
+
+#include <stdint.h>
+
+#define BATTERY_ADC 7				// ADC channel of the battery divider
+#define BATTERY_DIVIDER 2			// battery voltage over the ADC pin voltage
+#define ADC_REF_MV 3300				// AVcc, the ADC reference
+#define BATTERY_LOW_MV 3450			// LiPo voltage with a few minutes left
+#define BATTERY_LOW_READINGS 10		// low readings in a row before the battery is low
+#define LOW_BATTERY_SAVE_MS 60000	// time between saves of the last fix on a low battery
+
+void init_power(void);
+// Read the battery (called every scheduler tick), returns 1 while it is low
+uint8_t power_task(void);
+// Last battery reading in millivolts
+uint16_t battery_mv(void);
+
+#endif	// POWER_H_
@@ -0,0 +1,285 @@
+/*
+ * route_lib.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Route library
+ *
+ * The boot table keeps 9 bytes per route: the grid cell of the start point and
+ * the start point's offset within the cell. A lookup searches the cell of the
+ * position and its 8 neighbours, so every start point within a cell width is
+ * found whichever side of a cell edge it lies.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "route_lib.h"
+#include "crc.h"
+#include "sd.h"
+
+#define M_PER_UDEG_LAT 0.111195		// meters per microdegree of latitude
+#define DEG_TO_RAD_F 0.017453		// pi/180
+#define ROUTE_LINE_SIZE 40			// longest route file line
+#define ROUTE_CHUNK_SIZE 32			// bytes read from the card at a time
+
+// One route start point in the boot table
+typedef struct {
+	uint32_t cell;			// route_cell() of the start point
+	uint16_t lat;			// start point offset in the cell, microdegrees
+	uint16_t lon;
+	uint8_t route;			// record number in the index file
+} route_start;
+
+// Start points sorted by cell
+static route_start starts[ROUTE_LIB_MAX];
+static uint8_t num_starts;
+
+/*
+ * Gives the grid cell key of a position. Latitude and longitude are shifted to be
+ * positive so the key sorts by latitude row, then longitude.
+ *
+ * lat, lon: position in microdegrees
+ */
+uint32_t route_cell(int32_t lat, int32_t lon) {
+	uint32_t row = (uint32_t)(lat + 90000000L) / ROUTE_CELL_UDEG;
+	uint32_t col = (uint32_t)(lon + 180000000L) / ROUTE_CELL_UDEG;
+
+	return (row << 16) | col;
+}
+
+/*
+ * Gives the corner (smallest latitude and longitude) of a cell in microdegrees
+ */
+static void cell_corner(uint32_t cell, int32_t* lat, int32_t* lon) {
+	*lat = (int32_t)((cell >> 16) * ROUTE_CELL_UDEG) - 90000000L;
+	*lon = (int32_t)((cell & 0xFFFF) * ROUTE_CELL_UDEG) - 180000000L;
+}
+
+/*
+ * Adds a start point to the table, keeping it sorted by cell
+ */
+static void add_start(const route_lib_record* record, uint8_t route) {
+	route_start start;
+	int32_t lat, lon;
+	uint8_t i;
+
+	start.cell = route_cell(record->start_lat, record->start_lon);
+	cell_corner(start.cell, &lat, &lon);
+	start.lat = (uint16_t)(record->start_lat - lat);
+	start.lon = (uint16_t)(record->start_lon - lon);
+	start.route = route;
+
+	for (i = num_starts; i > 0 && starts[i - 1].cell > start.cell; i--)
+		starts[i] = starts[i - 1];
+
+	starts[i] = start;
+	num_starts++;
+}
+
+/*
+ * Loads the start point table from the index file on the card. The table is left
+ * empty if the file is missing, of another version or fails its CRC. Routes too
+ * long to load are not offered.
+ *
+ * return: the number of routes in the table
+ */
+uint8_t route_lib_init() {
+	route_lib_header header;
+	route_lib_record record;
+	uint16_t crc = CRC16_INIT;
+	uint8_t i;
+
+	num_starts = 0;
+
+	if (sd_read(ROUTE_LIB_FILE, 0, &header, sizeof(header)) != sizeof(header) ||
+			header.magic != ROUTE_LIB_MAGIC || header.version != ROUTE_LIB_VERSION)
+		return 0;
+
+	for (i = 0; i < header.num_routes; i++) {
+		if (route_lib_read(i, &record) != 0) {
+			num_starts = 0;
+			return 0;
+		}
+
+		crc = crc16(crc, &record, sizeof(record));
+		if (num_starts < ROUTE_LIB_MAX && record.num_waypts <= ROUTE_MAX_WAYPTS)
+			add_start(&record, i);
+	}
+
+	if (crc != header.crc)
+		num_starts = 0;
+
+	return num_starts;
+}
+
+/*
+ * Finds the first table entry with a cell not less than the given one
+ */
+static uint8_t find_cell(uint32_t cell) {
+	uint8_t low = 0;
+	uint8_t high = num_starts;
+
+	while (low < high) {
+		uint8_t mid = (low + high) / 2;
+
+		if (starts[mid].cell < cell)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+/*
+ * Finds the routes starting within ROUTE_NEAR_DISTANCE of a position. Only the
+ * boot table is searched, the card is not read.
+ *
+ * latitude, longitude: position in decimal degrees (the first valid fix)
+ * found: array to fill, nearest route first
+ * max: size of the array
+ *
+ * return: the number of routes found
+ */
+uint8_t route_lib_nearby(double latitude, double longitude, route_candidate* found,
+		uint8_t max) {
+	int32_t lat = (int32_t)lround(latitude * 1000000.0);
+	int32_t lon = (int32_t)lround(longitude * 1000000.0);
+	float lon_scale = M_PER_UDEG_LAT * cosf(latitude * DEG_TO_RAD_F);
+	uint8_t count = 0;
+	int8_t row, col;
+
+	for (row = -1; row <= 1; row++) {
+		for (col = -1; col <= 1; col++) {
+			uint32_t cell = route_cell(lat + row * (int32_t)ROUTE_CELL_UDEG,
+				lon + col * (int32_t)ROUTE_CELL_UDEG);
+			int32_t corner_lat, corner_lon;
+			uint8_t i;
+
+			cell_corner(cell, &corner_lat, &corner_lon);
+
+			for (i = find_cell(cell); i < num_starts && starts[i].cell == cell; i++) {
+				float north = (corner_lat + starts[i].lat - lat) * M_PER_UDEG_LAT;
+				float east = (corner_lon + starts[i].lon - lon) * lon_scale;
+				float distance = sqrtf(north * north + east * east);
+				uint8_t j;
+
+				if (distance > ROUTE_NEAR_DISTANCE)
+					continue;
+
+				// Insert by distance, the farthest falls off a full array
+				if (count < max)
+					count++;
+				else if (distance >= found[count - 1].distance)
+					continue;
+
+				for (j = count - 1; j > 0 && found[j - 1].distance > distance; j--)
+					found[j] = found[j - 1];
+
+				found[j].route = starts[i].route;
+				found[j].distance = (uint16_t)distance;
+			}
+		}
+	}
+
+	return count;
+}
+
+/*
+ * Reads the index record of a route from the card
+ *
+ * route: record number
+ * record: structure to fill
+ *
+ * return: 0 on success, 1 if the record can't be read
+ */
+uint8_t route_lib_read(uint8_t route, route_lib_record* record) {
+	uint32_t offset = sizeof(route_lib_header) + (uint32_t)route * sizeof(route_lib_record);
+
+	if (sd_read(ROUTE_LIB_FILE, offset, record, sizeof(*record)) != sizeof(*record))
+		return 1;
+
+	record->name[ROUTE_NAME_SIZE - 1] = 0;
+	return 0;
+}
+
+/*
+ * Parses one "latitude,longitude" route file line
+ *
+ * return: 1 if a waypoint was read, 0 for a blank or comment line, -1 if malformed
+ */
+static int8_t parse_line(const char* line, waypoint* waypt) {
+	char* end;
+
+	if (line[0] == 0 || line[0] == '#')
+		return 0;
+
+	waypt->latitude = strtod(line, &end);
+	if (end == line || *end != ',')
+		return -1;
+
+	line = end + 1;
+	waypt->longitude = strtod(line, &end);
+	if (end == line)
+		return -1;
+
+	return 1;
+}
+
+/*
+ * Reads the waypoints of a route from its file on the card, a piece at a time
+ *
+ * route: record number
+ * waypts: array to fill
+ * max: size of the array
+ *
+ * return: the number of waypoints read, 0 if the file is missing, malformed or
+ * 		holds more than max waypoints
+ */
+uint8_t route_lib_load(uint8_t route, waypoint* waypts, uint8_t max) {
+	route_lib_record record;
+	char chunk[ROUTE_CHUNK_SIZE];
+	char line[ROUTE_LINE_SIZE];
+	uint32_t offset = 0;
+	uint16_t read, i;
+	uint8_t line_pos = 0;
+	uint8_t count = 0;
+	uint8_t last;
+
+	if (route_lib_read(route, &record) != 0)
+		return 0;
+
+	do {
+		read = sd_read(record.name, offset, chunk, sizeof(chunk));
+		offset += read;
+
+		// A short read is the end of the file, a last line without a newline counts
+		last = (read < sizeof(chunk));
+		if (last)
+			chunk[read++] = '\n';
+
+		for (i = 0; i < read; i++) {
+			waypoint waypt;
+			int8_t result;
+
+			if (chunk[i] != '\n' && chunk[i] != '\r') {
+				if (line_pos == ROUTE_LINE_SIZE - 1)
+					return 0;
+				line[line_pos++] = chunk[i];
+				continue;
+			}
+
+			line[line_pos] = 0;
+			line_pos = 0;
+
+			result = parse_line(line, &waypt);
+			if (result < 0 || (result > 0 && count == max))
+				return 0;
+			if (result > 0)
+				waypts[count++] = waypt;
+		}
+	} while (!last);
+
+	return count;
+}
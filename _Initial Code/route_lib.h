@@ -0,0 +1,74 @@
+/*
+ * route_lib.h
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Header for the route library
+ *
+ * The routes saved on the SD card are listed in an index file (built on the host
+ * by Tools/route_index.c) with the start point, bounding box and file name of each
+ * route. At boot the start points are loaded into a table sorted by grid cell, so
+ * the routes starting near the first fix are found with a few binary searches and
+ * no route file is opened until one is chosen. Routes longer than the watch can
+ * hold (ROUTE_MAX_WAYPTS) are refused by the index builder and left out of the
+ * table.
+ *
+ * Index file layout (little-endian):
+ *
+ * 		route_lib_header, then num_routes route_lib_record
+ */
+
+#ifndef ROUTE_LIB_H_
+#define ROUTE_LIB_H_
+
+#include <stdint.h>
+#include "navigation.h"
+
+#define ROUTE_LIB_FILE "ROUTES.IDX"
+#define ROUTE_LIB_MAGIC 0x42494C52UL	// "RLIB"
+#define ROUTE_LIB_VERSION 1
+#define ROUTE_LIB_MAX 48			// routes the boot table can hold
+#define ROUTE_MAX_WAYPTS 64			// waypoints of the selected route held in RAM
+#define ROUTE_CELL_UDEG 10000		// grid cell size in microdegrees (about 1 km)
+#define ROUTE_NEAR_DISTANCE 300		// meters from a start point to offer the route
+#define ROUTE_NAME_SIZE 15			// 8.3 file name and terminator, padded
+
+// Start of the index file
+typedef struct {
+	uint32_t magic;			// ROUTE_LIB_MAGIC
+	uint8_t version;		// ROUTE_LIB_VERSION
+	uint8_t num_routes;
+	uint16_t crc;			// CRC-16 of all the records
+} route_lib_header;
+
+// One route in the index file (40 bytes, no padding on the host or the AVR)
+typedef struct {
+	int32_t start_lat;		// microdegrees
+	int32_t start_lon;
+	int32_t min_lat;		// bounding box, microdegrees
+	int32_t min_lon;
+	int32_t max_lat;
+	int32_t max_lon;
+	uint8_t num_waypts;
+	char name[ROUTE_NAME_SIZE];	// route file name on the card
+} route_lib_record;
+
+// A route starting near a position
+typedef struct {
+	uint8_t route;			// record number in the index file
+	uint16_t distance;		// meters to the start point
+} route_candidate;
+
+// Load the start point table from the index file, returns the number of routes
+uint8_t route_lib_init(void);
+// Find the routes starting near a position, nearest first, returns the count
+uint8_t route_lib_nearby(double, double, route_candidate*, uint8_t);
+// Read the index record of a route, returns 0 on success
+uint8_t route_lib_read(uint8_t, route_lib_record*);
+// Read the waypoints of a route from its file, returns the number read
+uint8_t route_lib_load(uint8_t, waypoint*, uint8_t);
+// Grid cell key of a position in microdegrees
+uint32_t route_cell(int32_t, int32_t);
+
+#endif	// ROUTE_LIB_H_
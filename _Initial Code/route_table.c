@@ -0,0 +1,151 @@
+/*
+ * route_table.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Routes compiled into flash
+ *
+ * Every read goes through the pgm_read macros, so the same code runs on the
+ * tables in flash on the watch and in memory on the host.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "route_table.h"
+
+#define M_PER_UDEG_LAT 0.111195		// meters per microdegree of latitude
+#define DEG_TO_RAD_F 0.017453		// pi/180
+
+/*
+ * Reads one point of the table
+ */
+static void read_point(const route_table* table, uint8_t i, route_table_point* point) {
+	const route_table_point* points = pgm_read_ptr(&table->points);
+
+	memcpy_P(point, &points[i], sizeof(*point));
+}
+
+uint8_t route_table_size(const route_table* table) {
+	return pgm_read_byte(&table->num_waypts);
+}
+
+/*
+ * Reads a waypoint in decimal degrees
+ */
+void route_table_waypt(const route_table* table, uint8_t i, waypoint* waypt) {
+	route_table_point point;
+
+	read_point(table, i, &point);
+	waypt->latitude = point.latitude / 1000000.0;
+	waypt->longitude = point.longitude / 1000000.0;
+}
+
+int16_t route_table_bearing(const route_table* table, uint8_t i) {
+	const route_table_point* points = pgm_read_ptr(&table->points);
+
+	return (int16_t)pgm_read_word(&points[i].leg_bearing);
+}
+
+direction route_table_turn(const route_table* table, uint8_t i) {
+	const route_table_point* points = pgm_read_ptr(&table->points);
+
+	return (direction)pgm_read_byte(&points[i].turn);
+}
+
+void route_table_name(const route_table* table, char* name) {
+	memcpy_P(name, table->name, ROUTE_NAME_SIZE);
+}
+
+/*
+ * Finds the first index entry with a cell not less than the given one
+ */
+static uint16_t find_cell(const route_table_cell* cells, uint16_t num_cells, uint32_t cell) {
+	uint16_t low = 0;
+	uint16_t high = num_cells;
+
+	while (low < high) {
+		uint16_t mid = (low + high) / 2;
+
+		if (pgm_read_dword(&cells[mid].cell) < cell)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+/*
+ * Gives the distance in meters from a position to a leg
+ *
+ * lat, lon: position in microdegrees
+ * lon_scale: meters per microdegree of longitude at the position
+ */
+static float leg_distance(const route_table* table, uint8_t leg, int32_t lat, int32_t lon,
+		float lon_scale) {
+	route_table_point from, to;
+	float ax, ay, bx, by, t;
+
+	read_point(table, leg, &from);
+	read_point(table, leg + 1, &to);
+
+	// Ends of the leg in meters east and north of the position
+	ax = (from.longitude - lon) * lon_scale;
+	ay = (from.latitude - lat) * M_PER_UDEG_LAT;
+	bx = (to.longitude - lon) * lon_scale;
+	by = (to.latitude - lat) * M_PER_UDEG_LAT;
+
+	// Nearest point of the leg to the origin
+	t = (bx - ax) * (bx - ax) + (by - ay) * (by - ay);
+	t = (t > 0) ? -(ax * (bx - ax) + ay * (by - ay)) / t : 0;
+	if (t < 0)
+		t = 0;
+	else if (t > 1)
+		t = 1;
+
+	ax += t * (bx - ax);
+	ay += t * (by - ay);
+	return sqrtf(ax * ax + ay * ay);
+}
+
+/*
+ * Finds the leg of the course nearest a position, searching the legs indexed in
+ * the cell of the position and its 8 neighbours
+ *
+ * latitude, longitude: position in decimal degrees
+ *
+ * return: the leg (from waypoint leg to leg + 1) if within ROUTE_NEAR_DISTANCE,
+ * 		ROUTE_TABLE_NONE otherwise
+ */
+uint8_t route_table_near(const route_table* table, double latitude, double longitude) {
+	const route_table_cell* cells = pgm_read_ptr(&table->cells);
+	uint16_t num_cells = pgm_read_word(&table->num_cells);
+	int32_t lat = (int32_t)lround(latitude * 1000000.0);
+	int32_t lon = (int32_t)lround(longitude * 1000000.0);
+	float lon_scale = M_PER_UDEG_LAT * cosf(latitude * DEG_TO_RAD_F);
+	float nearest = ROUTE_NEAR_DISTANCE;
+	uint8_t found = ROUTE_TABLE_NONE;
+	int8_t row, col;
+
+	for (row = -1; row <= 1; row++) {
+		for (col = -1; col <= 1; col++) {
+			uint32_t cell = route_cell(lat + row * (int32_t)ROUTE_CELL_UDEG,
+				lon + col * (int32_t)ROUTE_CELL_UDEG);
+			uint16_t i;
+
+			for (i = find_cell(cells, num_cells, cell);
+					i < num_cells && pgm_read_dword(&cells[i].cell) == cell; i++) {
+				uint8_t leg = pgm_read_byte(&cells[i].leg);
+				float distance = leg_distance(table, leg, lat, lon, lon_scale);
+
+				if (distance <= nearest) {
+					nearest = distance;
+					found = leg;
+				}
+			}
+		}
+	}
+
+	return found;
+}
@@ -0,0 +1,80 @@
+/*
+ * route_table.h
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Header for routes compiled into flash
+ *
+ * A fixed course (a race flashed onto event watches) can be compiled on the host
+ * by Tools/route_compile.c into a C source with constant tables in program memory.
+ * The tables hold everything the navigation would otherwise work out at the start
+ * and during the run: the waypoints in microdegrees, the length and bearing of the
+ * leg leaving each waypoint, the turn of the course at each waypoint, and an index
+ * of the grid cells (route_cell()) each leg passes through. The navigation reads
+ * them in place, nothing of the route is copied to RAM.
+ *
+ * Build the watch with the generated source and -DHAVE_COURSE to race the course
+ * instead of the routes of the card.
+ */
+
+#ifndef ROUTE_TABLE_H_
+#define ROUTE_TABLE_H_
+
+#include <stdint.h>
+#include "navigation.h"
+#include "route_lib.h"
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#else
+// Host builds (Tools/) keep the tables in ordinary memory
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+#define pgm_read_ptr(p) (*(const void* const*)(p))
+#define memcpy_P memcpy
+#endif
+
+#define ROUTE_TABLE_NONE 0xFF		// no leg near the position
+
+// One waypoint and the leg leaving it
+typedef struct {
+	int32_t latitude;		// microdegrees
+	int32_t longitude;
+	uint16_t leg_length;	// meters to the next waypoint (0 for the last)
+	int16_t leg_bearing;	// degrees to the next waypoint
+	uint8_t turn;			// direction of the course at this waypoint
+} route_table_point;
+
+// A grid cell a leg passes through
+typedef struct {
+	uint32_t cell;			// route_cell()
+	uint8_t leg;			// leg from waypoint leg to leg + 1
+} route_table_cell;
+
+// A compiled route, in program memory like its tables
+typedef struct route_table {
+	const route_table_point* points;
+	const route_table_cell* cells;	// sorted by cell
+	uint16_t num_cells;
+	uint8_t num_waypts;
+	uint32_t length;		// meters
+	char name[ROUTE_NAME_SIZE];	// route file name, for the track and the ghost
+} route_table;
+
+// Number of waypoints of a compiled route
+uint8_t route_table_size(const route_table*);
+// Read one waypoint
+void route_table_waypt(const route_table*, uint8_t, waypoint*);
+// Bearing of the leg leaving a waypoint
+int16_t route_table_bearing(const route_table*, uint8_t);
+// Turn of the course at a waypoint
+direction route_table_turn(const route_table*, uint8_t);
+// Copy the route file name (ROUTE_NAME_SIZE bytes)
+void route_table_name(const route_table*, char*);
+// Find the leg nearest a position within ROUTE_NEAR_DISTANCE, or ROUTE_TABLE_NONE
+uint8_t route_table_near(const route_table*, double, double);
+
+#endif	// ROUTE_TABLE_H_
@@ -0,0 +1,206 @@
+/*
+ * run_stats.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Run statistics
+ *
+ * The rolling pace windows share one ring of per-fix distance and time. Each window
+ * keeps running sums and a tail index: a new fix is added to the sums and the fixes
+ * that fall out of the window are subtracted, so an update never walks the history.
+ */
+
+#include "run_stats.h"
+
+static void split_init(split_times*, uint32_t);
+static void split_update(split_times*, const run_stats*, uint16_t, uint16_t);
+static void drop_oldest(const run_stats*, pace_window*);
+
+/*
+ * Removes the oldest fix from a pace window
+ */
+static void drop_oldest(const run_stats* stats, pace_window* w) {
+	w->distance -= stats->ring_distance[w->tail];
+	w->ms -= stats->ring_ms[w->tail];
+	w->tail = (w->tail + 1) % STATS_RING_SIZE;
+	w->count--;
+}
+
+/*
+ * Starts the split times for one split length
+ */
+static void split_init(split_times* split, uint32_t length) {
+	split->length = length;
+	split->next = length;
+	split->start_ms = 0;
+	split->last_ms = 0;
+	split->best_ms = 0;
+	split->count = 0;
+}
+
+/*
+ * Closes a split if the last fix crossed its end. The crossing time is interpolated
+ * within the fix so the split isn't rounded to the fix interval.
+ *
+ * split: split times to update
+ * stats: statistics already holding the new fix
+ * distance: cm covered by the new fix
+ * ms: time covered by the new fix
+ */
+static void split_update(split_times* split, const run_stats* stats, uint16_t distance,
+		uint16_t ms) {
+	if (stats->distance < split->next || distance == 0)
+		return;
+
+	// Time at which the split distance was passed
+	uint32_t over = stats->distance - split->next;
+	uint32_t crossed_ms = stats->elapsed_ms - (uint32_t)((uint32_t)ms * over / distance);
+
+	split->last_ms = crossed_ms - split->start_ms;
+	if (split->count == 0 || split->last_ms < split->best_ms)
+		split->best_ms = split->last_ms;
+	split->count++;
+	split->start_ms = crossed_ms;
+	split->next += split->length;
+}
+
+/*
+ * Resets the statistics for a new run
+ */
+void stats_init(run_stats* stats) {
+	uint8_t i;
+
+	stats->distance = 0;
+	stats->elapsed_ms = 0;
+	stats->moving_ms = 0;
+	stats->stopped_ms = 0;
+
+	split_init(&stats->km, SPLIT_KM);
+	split_init(&stats->mile, SPLIT_MILE);
+
+	stats->head = 0;
+	stats->windows[0].window_ms = PACE_WINDOW_SHORT * 1000UL;
+	stats->windows[1].window_ms = PACE_WINDOW_LONG * 1000UL;
+	for (i = 0; i < STATS_NUM_WINDOWS; i++) {
+		stats->windows[i].tail = 0;
+		stats->windows[i].count = 0;
+		stats->windows[i].distance = 0;
+		stats->windows[i].ms = 0;
+	}
+
+	stats->elevation_gain = 0;
+	stats->elevation_loss = 0;
+	stats->have_elevation = 0;
+}
+
+/*
+ * Adds one fix to the statistics
+ *
+ * stats: statistics to update
+ * distance: cm covered since the last fix (0 if the fix was rejected)
+ * ms: time since the last fix
+ * speed: filtered speed in m/s
+ * altitude: GPS altitude in meters
+ */
+void stats_update(run_stats* stats, uint16_t distance, uint16_t ms, float speed,
+		int16_t altitude) {
+	uint8_t i;
+
+	stats->distance += distance;
+	stats->elapsed_ms += ms;
+
+	if (speed >= MOVING_SPEED)
+		stats->moving_ms += ms;
+	else
+		stats->stopped_ms += ms;
+
+	split_update(&stats->km, stats, distance, ms);
+	split_update(&stats->mile, stats, distance, ms);
+
+	// Rolling windows: add the new fix, drop what has fallen out of each window
+	for (i = 0; i < STATS_NUM_WINDOWS; i++) {
+		pace_window* w = &stats->windows[i];
+
+		// The oldest entry is about to be overwritten
+		if (w->count == STATS_RING_SIZE)
+			drop_oldest(stats, w);
+
+		w->distance += distance;
+		w->ms += ms;
+		w->count++;
+	}
+
+	stats->ring_distance[stats->head] = distance;
+	stats->ring_ms[stats->head] = ms;
+	stats->head = (stats->head + 1) % STATS_RING_SIZE;
+
+	for (i = 0; i < STATS_NUM_WINDOWS; i++) {
+		pace_window* w = &stats->windows[i];
+
+		while (w->count > 1 && w->ms - stats->ring_ms[w->tail] >= w->window_ms)
+			drop_oldest(stats, w);
+	}
+
+	// Elevation with hysteresis so GPS altitude noise doesn't add up to a climb
+	if (!stats->have_elevation) {
+		stats->elevation_ref = altitude;
+		stats->have_elevation = 1;
+	} else if (altitude - stats->elevation_ref >= ELEVATION_HYSTERESIS) {
+		stats->elevation_gain += altitude - stats->elevation_ref;
+		stats->elevation_ref = altitude;
+	} else if (stats->elevation_ref - altitude >= ELEVATION_HYSTERESIS) {
+		stats->elevation_loss += stats->elevation_ref - altitude;
+		stats->elevation_ref = altitude;
+	}
+}
+
+/*
+ * Gives the pace over one of the rolling windows
+ *
+ * window: index of the window (0 = PACE_WINDOW_SHORT, 1 = PACE_WINDOW_LONG)
+ *
+ * return: seconds per kilometer, 0 if no distance was covered in the window
+ */
+uint16_t stats_pace(const run_stats* stats, uint8_t window) {
+	const pace_window* w = &stats->windows[window];
+	uint32_t pace;
+
+	if (w->distance == 0)
+		return 0;
+
+	// (ms / 1000) / (cm / 100000) = ms * 100 / cm
+	pace = w->ms * 100 / w->distance;
+
+	return (pace > UINT16_MAX) ? UINT16_MAX : (uint16_t)pace;
+}
+
+/*
+ * Gives the average pace over the time spent moving
+ *
+ * return: seconds per kilometer, 0 before any distance is covered
+ */
+uint16_t stats_average_pace(const run_stats* stats) {
+	uint32_t pace;
+
+	if (stats->distance < 100)
+		return 0;
+
+	// ms * 100 / cm overflows 32 bits after 11 hours, so scale the distance instead
+	pace = stats->moving_ms / (stats->distance / 100);
+
+	return (pace > UINT16_MAX) ? UINT16_MAX : (uint16_t)pace;
+}
+
+/*
+ * Fills a run summary from the statistics
+ */
+void stats_summary(const run_stats* stats, run_summary* summary) {
+	summary->distance = stats->distance;
+	summary->elapsed_ms = stats->elapsed_ms;
+	summary->moving_ms = stats->moving_ms;
+	summary->best_km_ms = stats->km.best_ms;
+	summary->average_pace = stats_average_pace(stats);
+	summary->elevation_gain = stats->elevation_gain;
+	summary->elevation_loss = stats->elevation_loss;
+}
@@ -0,0 +1,90 @@
+/*
+ * run_stats.h
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Header for the run statistics
+ *
+ * Statistics are updated once per fix in constant time and memory: splits, rolling
+ * pace, moving/stopped time and elevation gain/loss are kept as running values so
+ * nothing has to be recomputed from the history for the display or at the finish.
+ */
+
+#ifndef RUN_STATS_H_
+#define RUN_STATS_H_
+
+#include <stdint.h>
+
+#define STATS_RING_SIZE 64		// fixes kept for the rolling pace windows
+#define STATS_NUM_WINDOWS 2		// rolling pace windows
+#define PACE_WINDOW_SHORT 10	// seconds
+#define PACE_WINDOW_LONG 60		// seconds
+#define MOVING_SPEED 0.8		// m/s at or above which the user is moving
+#define ELEVATION_HYSTERESIS 3	// meters of climb or descent before it counts
+#define SPLIT_KM 100000UL		// centimeters in a kilometer
+#define SPLIT_MILE 160934UL		// centimeters in a mile
+
+// Split times for one split length
+typedef struct {
+	uint32_t length;		// centimeters
+	uint32_t next;			// distance at which the next split ends (cm)
+	uint32_t start_ms;		// run time at which the current split started
+	uint32_t last_ms;		// time of the last completed split
+	uint32_t best_ms;		// time of the fastest completed split
+	uint16_t count;			// completed splits
+} split_times;
+
+// Running sums over the last window_ms of the run
+typedef struct {
+	uint32_t window_ms;		// window length
+	uint8_t tail;			// oldest ring entry in the window
+	uint8_t count;			// ring entries in the window
+	uint32_t distance;		// cm in the window
+	uint32_t ms;			// time in the window
+} pace_window;
+
+typedef struct {
+	uint32_t distance;		// cm run
+	uint32_t elapsed_ms;	// time since the start of the run
+	uint32_t moving_ms;		// time at or above MOVING_SPEED
+	uint32_t stopped_ms;	// time below MOVING_SPEED
+
+	split_times km;
+	split_times mile;
+
+	// Distance and time of the recent fixes, shared by the pace windows
+	uint16_t ring_distance[STATS_RING_SIZE];	// cm
+	uint16_t ring_ms[STATS_RING_SIZE];
+	uint8_t head;			// next ring entry to write
+	pace_window windows[STATS_NUM_WINDOWS];
+
+	int16_t elevation_ref;	// altitude the hysteresis is measured from
+	uint16_t elevation_gain;	// meters
+	uint16_t elevation_loss;	// meters
+	uint8_t have_elevation;
+} run_stats;
+
+// Summary of a finished run, as stored in the run history
+typedef struct {
+	uint32_t distance;		// cm
+	uint32_t elapsed_ms;
+	uint32_t moving_ms;
+	uint32_t best_km_ms;	// fastest kilometer split (0 if none)
+	uint16_t average_pace;	// seconds per kilometer while moving
+	uint16_t elevation_gain;	// meters
+	uint16_t elevation_loss;	// meters
+} run_summary;
+
+// Reset the statistics for a new run
+void stats_init(run_stats*);
+// Add one fix: distance (cm) and time (ms) since the last, speed (m/s), altitude (m)
+void stats_update(run_stats*, uint16_t, uint16_t, float, int16_t);
+// Pace over a rolling window in seconds per kilometer (0 if not moving)
+uint16_t stats_pace(const run_stats*, uint8_t);
+// Average pace over the moving time in seconds per kilometer (0 if not moving)
+uint16_t stats_average_pace(const run_stats*);
+// Fill a run summary from the statistics
+void stats_summary(const run_stats*, run_summary*);
+
+#endif	// RUN_STATS_H_
@@ -4,12 +4,71 @@
  * Created 2013/12/23
  * Author: Joel Heck
  * 
- * Adapted from code "gps.c" created by Brian on 30 Mar 2012 for a 4760
- * project
- *
- * Defines functions used for GPS data collection over UART
+ * Defines functions used for reading files from the SD card
  */
 
+#include "sd.h"
+
+/*
+ * Starts the card in SPI mode and mounts the FAT file system
+ *
+ * return: 0 if the card is ready, 1 if there is no card or it can't be read
+ */
 uint8_t init_sd() {
-	
-}
\ No newline at end of file
+	/*INSERT SD CARD SPI START AND FAT MOUNT*/
+	return 1;
+}
+
+/*
+ * Reads part of a file
+ *
+ * name: 8.3 file name in the root directory
+ * offset: byte offset in the file
+ * data: buffer to fill
+ * length: bytes wanted
+ *
+ * return: the bytes read, less than length at the end of the file, 0 on error
+ */
+uint16_t sd_read(const char* name, uint32_t offset, void* data, uint16_t length) {
+	(void)name;
+	(void)offset;
+	(void)data;
+	(void)length;
+
+	/*INSERT FAT FILE LOOKUP AND SECTOR READS*/
+	return 0;
+}
+
+/*
+ * Writes part of a file. The file is created if missing and grows when written
+ * past its end.
+ *
+ * name: 8.3 file name in the root directory
+ * offset: byte offset in the file
+ * data: bytes to write
+ * length: number of bytes
+ *
+ * return: 0 on success, 1 on error (no card, card full)
+ */
+uint8_t sd_write(const char* name, uint32_t offset, const void* data, uint16_t length) {
+	(void)name;
+	(void)offset;
+	(void)data;
+	(void)length;
+
+	/*INSERT FAT CLUSTER ALLOCATION AND SECTOR WRITES*/
+	return 1;
+}
+
+/*
+ * Renames a file, replacing any file that already has the new name
+ *
+ * return: 0 on success, 1 on error (no such file)
+ */
+uint8_t sd_rename(const char* from, const char* to) {
+	(void)from;
+	(void)to;
+
+	/*INSERT FAT DIRECTORY ENTRY UPDATE*/
+	return 1;
+}
@@ -4,10 +4,24 @@
  * Created: 2013/12/23
  * Author: Joel Heck
  *
- * Header for UART functions
+ * Header for SD card functions
  *
- * Adapted from code "uart1.h" created by Brian on 30 Mar 2012 for a 4760
- * project
- *
- * Defines data structures and declares functions used for GPS data processing
- */
\ No newline at end of file
+ * Files on the card are read by name in pieces, so a file never has to fit in
+ * RAM. The card shares the SPI bus with the display.
+ */
+
+#ifndef SD_H_
+#define SD_H_
+
+#include <stdint.h>
+
+// Start the card and mount its file system, returns 0 if the card is ready
+uint8_t init_sd(void);
+// Read part of a file, returns the bytes read (0 past the end or on error)
+uint16_t sd_read(const char*, uint32_t, void*, uint16_t);
+// Write part of a file (creating or growing it), returns 0 on success
+uint8_t sd_write(const char*, uint32_t, const void*, uint16_t);
+// Rename a file, replacing any file of the new name, returns 0 on success
+uint8_t sd_rename(const char*, const char*);
+
+#endif	// SD_H_
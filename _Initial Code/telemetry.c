@@ -0,0 +1,246 @@
+/*
+ * telemetry.c
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Binary telemetry
+ */
+
+#include "telemetry.h"
+#include "crc.h"
+#include "ghost.h"
+#include "uart.h"
+
+// Messages waiting to be sent (after two header bytes, room left for the CRC)
+static uint8_t batch[TELEMETRY_FRAME_SIZE];
+static uint8_t batch_length;
+// Run clock time the oldest waiting message was queued
+static uint32_t batch_since;
+// A cue is waiting, send without waiting for more messages
+static uint8_t batch_urgent;
+// Messages dropped since the last frame
+static uint8_t dropped;
+static uint8_t sequence;
+// Encoded frame (must live until sent)
+static char frame[TELEMETRY_ENCODED_SIZE];
+
+// What has been reported of the run
+static uint32_t sent_fix_ms;
+static uint32_t sent_cue_ms;
+static uint32_t sent_nav_ms;
+
+void init_telemetry() {
+	batch_length = 0;
+	batch_urgent = 0;
+	dropped = 0;
+	sequence = 0;
+	sent_fix_ms = 0;
+	sent_cue_ms = 0;
+	sent_nav_ms = 0;
+}
+
+/*
+ * Writes little endian values
+ *
+ * return: pointer past the value
+ */
+static uint8_t* put16(uint8_t* p, uint16_t value) {
+	*p++ = (uint8_t)value;
+	*p++ = (uint8_t)(value >> 8);
+	return p;
+}
+
+static uint8_t* put32(uint8_t* p, uint32_t value) {
+	p = put16(p, (uint16_t)value);
+	return put16(p, (uint16_t)(value >> 16));
+}
+
+/*
+ * Starts a message in the batch
+ *
+ * now: run clock time in ms
+ *
+ * return: pointer to the payload, or NULL if the message doesn't fit (dropped)
+ */
+static uint8_t* start_message(uint8_t type, uint8_t length, uint32_t now) {
+	uint8_t* p;
+
+	if (batch_length + 2 + length > TELEMETRY_BATCH_SIZE) {
+		if (dropped < 255)
+			dropped++;
+		return NULL;
+	}
+
+	if (batch_length == 0)
+		batch_since = now;
+
+	p = &batch[2 + batch_length];
+	*p++ = type;
+	*p++ = length;
+	batch_length += 2 + length;
+
+	return p;
+}
+
+/*
+ * Converts decimal degrees to microdegrees
+ */
+static int32_t microdegrees(double degrees) {
+	return (int32_t)(degrees * 1e6 + ((degrees < 0) ? -0.5 : 0.5));
+}
+
+static void queue_fix(const gps_fix* fix, uint32_t now) {
+	uint8_t* p = start_message(TLM_FIX, TLM_FIX_SIZE, now);
+
+	if (p == NULL)
+		return;
+
+	p = put32(p, fix->stamp);
+	p = put32(p, fix->utc_ms);
+	p = put32(p, (uint32_t)microdegrees(fix->latitude));
+	p = put32(p, (uint32_t)microdegrees(fix->longitude));
+	p = put16(p, (uint16_t)fix->altitude);
+	*p++ = (fix->speed < 0) ? 0 : (uint8_t)fix->speed;
+	*p = fix->valid;
+}
+
+static void queue_nav(const nav_state* nav, uint32_t now) {
+	uint8_t* p = start_message(TLM_NAV, TLM_NAV_SIZE, now);
+	uint8_t flags = 0;
+
+	if (p == NULL)
+		return;
+
+	if (nav->complete)
+		flags |= TLM_NAV_COMPLETE;
+	if (nav->cue_given)
+		flags |= TLM_NAV_CUE_GIVEN;
+	if (nav->scheduled_turn != NONE)
+		flags |= TLM_NAV_CUE_SCHEDULED;
+	if (nav->ghost != NULL && nav->ghost->lead > 0)
+		flags |= TLM_NAV_GHOST_AHEAD;
+	else if (nav->ghost != NULL && nav->ghost->lead < 0)
+		flags |= TLM_NAV_GHOST_BEHIND;
+
+	p = put32(p, now);
+	*p++ = nav->current_waypt_num;
+	*p++ = nav->num_waypts_in_route;
+	p = put16(p, nav->distance_to_waypt);
+	p = put16(p, (uint16_t)nav->heading);
+	*p = flags;
+}
+
+static void queue_cue(const nav_state* nav, uint32_t now) {
+	uint8_t* p = start_message(TLM_CUE, TLM_CUE_SIZE, now);
+
+	if (p == NULL)
+		return;
+
+	p = put32(p, nav->last_cue_ms);
+	*p++ = nav->cue_waypt;
+	*p = (uint8_t)nav->last_turn;
+	batch_urgent = 1;
+}
+
+static void queue_stats(const run_stats* stats, uint32_t now) {
+	uint8_t* p = start_message(TLM_STATS, TLM_STATS_SIZE, now);
+
+	if (p == NULL)
+		return;
+
+	p = put32(p, stats->elapsed_ms);
+	p = put32(p, stats->distance);
+	p = put32(p, stats->moving_ms);
+	p = put16(p, stats_pace(stats, 0));
+	p = put16(p, stats_average_pace(stats));
+	p = put16(p, stats->elevation_gain);
+	put16(p, stats->elevation_loss);
+}
+
+/*
+ * Queues the messages due for the run: a fix and the statistics after each new
+ * fix, a cue when one was given and the navigation state every TELEMETRY_NAV_MS.
+ *
+ * now: run clock time in ms
+ */
+void telemetry_run(const nav_state* nav, uint32_t now) {
+	gps_fix fix;
+
+	if (nav->prev_fix_ms != sent_fix_ms) {
+		sent_fix_ms = nav->prev_fix_ms;
+		get_fix(&fix);
+		queue_fix(&fix, now);
+		queue_stats(&nav->stats, now);
+	}
+
+	if (nav->last_cue_ms != sent_cue_ms) {
+		sent_cue_ms = nav->last_cue_ms;
+		queue_cue(nav, now);
+	}
+
+	if (now - sent_nav_ms >= TELEMETRY_NAV_MS) {
+		sent_nav_ms = now;
+		queue_nav(nav, now);
+	}
+}
+
+/*
+ * COBS encodes a buffer and ends it with a zero byte. Each zero is replaced by the
+ * distance to the next one, a code byte of 0xFF means 254 bytes without a zero.
+ *
+ * return: encoded length including the zero at the end
+ */
+static uint8_t cobs_encode(const uint8_t* data, uint8_t length, char* out) {
+	uint8_t code_at = 0;
+	uint8_t code = 1;
+	uint8_t n = 1;
+	uint8_t i;
+
+	for (i = 0; i < length; i++) {
+		if (data[i] != 0)
+			out[n++] = data[i];
+		if (data[i] == 0 || ++code == 0xFF) {
+			out[code_at] = code;
+			code_at = n++;
+			code = 1;
+		}
+	}
+
+	out[code_at] = code;
+	out[n++] = 0;
+
+	return n;
+}
+
+/*
+ * Sends the batch as one frame once it is due: when a cue is waiting, when it is
+ * more than half full or when its oldest message has waited TELEMETRY_BATCH_MS.
+ * GPS commands go first, the batch keeps collecting while they are sent.
+ *
+ * now: run clock time in ms
+ */
+void telemetry_task(uint32_t now) {
+	uint8_t length;
+
+	if (batch_length == 0 || gps_commands_waiting() || uart_busy())
+		return;
+
+	if (!batch_urgent && batch_length < TELEMETRY_BATCH_SIZE / 2 &&
+			now - batch_since < TELEMETRY_BATCH_MS)
+		return;
+
+	batch[0] = sequence;
+	batch[1] = dropped;
+	length = 2 + batch_length;
+	put16(&batch[length], crc16(CRC16_INIT, batch, length));
+
+	length = cobs_encode(batch, length + 2, frame);
+	if (uart_send(frame, length) != 0)
+		return;
+
+	sequence++;
+	batch_length = 0;
+	batch_urgent = 0;
+	dropped = 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * telemetry.h
+ *
+ * Created: 2026/10/19
+ * Author: Joel Heck
+ *
+ * Header for the binary telemetry
+ *
+ * Fixes, navigation state, cues and statistics are sent as small fixed-point
+ * messages instead of text. Messages are collected in a batch and sent together
+ * as one frame:
+ *
+ *   sequence (1) | dropped (1) | message ... | CRC-16 (2)
+ *   message = type (1) | length (1) | payload (length)
+ *
+ * All values are little endian. The frame is COBS encoded (no zero bytes inside)
+ * and ended with a zero byte, so a receiver that joins late or loses a byte finds
+ * the next frame at the next zero. The CRC (crc.h) is over everything before it,
+ * the sequence counts frames and dropped counts the messages that did not fit
+ * since the last frame. A receiver skips message types it doesn't know.
+ *
+ * The telemetry shares the UART with the GPS commands and only sends when no
+ * command is waiting (see gps_task()).
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+#include "gps.h"
+#include "navigation.h"
+
+#define TELEMETRY_BATCH_SIZE 80		// message bytes collected in one frame
+#define TELEMETRY_FRAME_SIZE (TELEMETRY_BATCH_SIZE + 4)	// with header and CRC
+// Largest encoded frame: one COBS byte per 254 and the zero at the end
+#define TELEMETRY_ENCODED_SIZE (TELEMETRY_FRAME_SIZE + TELEMETRY_FRAME_SIZE / 254 + 2)
+#define TELEMETRY_BATCH_MS 1000		// longest a message waits for more to batch with
+#define TELEMETRY_NAV_MS 1000		// time between navigation state messages
+
+// Message types
+#define TLM_FIX 1
+#define TLM_NAV 2
+#define TLM_CUE 3
+#define TLM_STATS 4
+
+// Payload lengths
+#define TLM_FIX_SIZE 20
+#define TLM_NAV_SIZE 11
+#define TLM_CUE_SIZE 6
+#define TLM_STATS_SIZE 20
+
+// Flags of a navigation state message
+#define TLM_NAV_COMPLETE 0x01		// last waypoint reached
+#define TLM_NAV_CUE_GIVEN 0x02		// cue given for the next waypoint
+#define TLM_NAV_CUE_SCHEDULED 0x04	// cue waiting for its time
+#define TLM_NAV_GHOST_AHEAD 0x08	// ahead of the reference run
+#define TLM_NAV_GHOST_BEHIND 0x10	// behind the reference run
+
+/*
+ * Payloads
+ *
+ * FIX:   stamp u32 (run clock ms) | utc_ms u32 | latitude i32 | longitude i32
+ *        (microdegrees) | altitude i16 (m) | speed u8 (km/h) | valid u8
+ *        -- the course is in NAV, the fix's own is not needed
+ * NAV:   stamp u32 | waypoint u8 | waypoints u8 | distance u16 (m to the waypoint)
+ *        | heading i16 (degrees) | flags u8
+ * CUE:   stamp u32 | waypoint u8 | direction u8 (navigation.h)
+ * STATS: elapsed u32 (ms) | distance u32 (cm) | moving u32 (ms) | pace u16
+ *        (s/km, rolling) | average pace u16 (s/km) | gain u16 (m) | loss u16 (m)
+ */
+
+void init_telemetry(void);
+// Queue the messages due for the run (called every scheduler tick)
+void telemetry_run(const nav_state*, uint32_t);
+// Send the batch when it is due and the UART is free (called every scheduler tick)
+void telemetry_task(uint32_t);
+
+#endif	// TELEMETRY_H_
@@ -88,4 +88,11 @@ uint8_t uart_send(char* buffer, uint8_t size){
 
 		return 0;
 	}
-}
\ No newline at end of file
+}
+
+/*
+ * Tells whether the last buffer given to uart_send() is still being sent
+ */
+uint8_t uart_busy(){
+	return buffer_size != 0;
+}
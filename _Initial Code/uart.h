@@ -20,5 +20,7 @@
 
 void uart_init(void);
 uint8_t uart_send(char*, uint8_t);
+// Tells whether a buffer is still being sent
+uint8_t uart_busy(void);
 
 #endif 	// UART_H_
\ No newline at end of file
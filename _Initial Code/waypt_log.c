@@ -3,9 +3,98 @@
  *
  * Created 2013/12/22
  * Author: Joel Heck
- * 
- * Adapted from code "gps.c" created by Brian on 30 Mar 2012 for a 4760
- * project
  *
- * Defines functions used for GPS data collection over UART
- */
\ No newline at end of file
+ * Defines functions used for logging the track of a run to the SD card
+ */
+
+#include <math.h>
+#include "waypt_log.h"
+#include "sd.h"
+
+// Route file of the run being logged
+static char log_route[ROUTE_NAME_SIZE];
+// Track file being written, empty if no run is being logged
+static char log_name[ROUTE_NAME_SIZE];
+// Bytes written to the track file
+static uint32_t log_size;
+
+/*
+ * Makes a track file name from a route file name by replacing its extension
+ *
+ * route_name: route file name (8.3)
+ * ext: new extension without the dot
+ * name: buffer of ROUTE_NAME_SIZE characters to fill
+ */
+void track_name(const char* route_name, const char* ext, char* name) {
+	uint8_t i = 0;
+
+	while (route_name[i] != 0 && route_name[i] != '.' && i < 8) {
+		name[i] = route_name[i];
+		i++;
+	}
+
+	name[i++] = '.';
+	while (*ext != 0)
+		name[i++] = *ext++;
+	name[i] = 0;
+}
+
+/*
+ * Starts logging a new run of a route. The track of an earlier unfinished run of
+ * the route is overwritten.
+ *
+ * route_name: route file name
+ */
+void waypt_log_start(const char* route_name) {
+	uint8_t i;
+
+	for (i = 0; i < ROUTE_NAME_SIZE - 1 && route_name[i] != 0; i++)
+		log_route[i] = route_name[i];
+	log_route[i] = 0;
+
+	track_name(log_route, TRACK_NEW_EXT, log_name);
+	log_size = 0;
+}
+
+/*
+ * Appends a fix to the track file
+ *
+ * stats: run statistics after the fix
+ * location: filtered position of the fix
+ *
+ * return: 0 on success, 1 if no run is being logged or the write failed
+ */
+uint8_t waypt_log_fix(const run_stats* stats, const waypoint* location) {
+	track_record record;
+
+	if (log_name[0] == 0)
+		return 1;
+
+	record.elapsed_ms = stats->elapsed_ms;
+	record.distance = stats->distance;
+	record.latitude = (int32_t)lround(location->latitude * 1000000.0);
+	record.longitude = (int32_t)lround(location->longitude * 1000000.0);
+
+	if (sd_write(log_name, log_size, &record, sizeof(record)) != 0)
+		return 1;
+
+	log_size += sizeof(record);
+	return 0;
+}
+
+/*
+ * Ends the log of a complete run and keeps it as the route's reference run
+ */
+void waypt_log_finish() {
+	char name[ROUTE_NAME_SIZE];
+
+	if (log_name[0] == 0)
+		return;
+
+	track_name(log_route, TRACK_EXT, name);
+
+	if (log_size > 0)
+		sd_rename(log_name, name);
+
+	log_name[0] = 0;
+}
@@ -4,10 +4,41 @@
  * Created: 2013/12/22
  * Author: Joel Heck
  *
- * Header for UART functions
+ * Header for the track log
  *
- * Adapted from code "uart1.h" created by Brian on 30 Mar 2012 for a 4760
- * project
- *
- * Defines data structures and declares functions used for GPS data processing
- */
\ No newline at end of file
+ * Every valid fix of a run is appended to a track file on the SD card, named after
+ * the route file with the extension TRACK_NEW_EXT. When the run is complete the
+ * file is renamed to TRACK_EXT and becomes the reference run the ghost pacer
+ * (ghost.c) races on the next run of the route. A track file is a plain array of
+ * track_record (little-endian), one per fix in time order. Files are not
+ * truncated, so a record earlier in time than the one before it ends the track.
+ */
+
+#ifndef WAYPT_LOG_H_
+#define WAYPT_LOG_H_
+
+#include <stdint.h>
+#include "navigation.h"
+#include "route_lib.h"
+
+#define TRACK_EXT "TRK"			// last complete run of a route
+#define TRACK_NEW_EXT "NEW"		// run being logged
+
+// One logged fix (16 bytes)
+typedef struct {
+	uint32_t elapsed_ms;	// run time of the fix
+	uint32_t distance;		// cm run at the fix
+	int32_t latitude;		// microdegrees
+	int32_t longitude;		// microdegrees
+} track_record;
+
+// Make a track file name from a route file name and an extension
+void track_name(const char*, const char*, char*);
+// Start logging a run of a route (by route file name)
+void waypt_log_start(const char*);
+// Append a fix to the log, returns 1 if it could not be written
+uint8_t waypt_log_fix(const run_stats*, const waypoint*);
+// Keep the log of a complete run as the route's reference run
+void waypt_log_finish(void);
+
+#endif	// WAYPT_LOG_H_